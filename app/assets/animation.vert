@@ -44,7 +44,7 @@ layout(std430, binding = 2) readonly buffer ssbo2 {
 // ============================ Main ============================
 void main()
 {
-    uint curID = gl_DrawID + gl_InstanceID;
+    uint curID = gl_BaseInstance + gl_InstanceID;
     InstanceData inst = data[curID];
 
     mat4 model = inst.model;
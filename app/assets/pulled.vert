@@ -0,0 +1,73 @@
+#version 460 core
+
+#extension GL_ARB_bindless_texture : require
+
+// Vertex pulling version of shader.vert for VertexFormat::PACKED static
+// geometry, use with BufferManager::SetVertexPulling(true). There are no
+// vertex attributes, gl_VertexID already includes the command's baseVertex.
+
+out vec2 TexCoords;
+out vec3 FragNormal;
+
+struct VP {
+    mat4 view;
+    mat4 projection;
+};
+
+layout(binding = 5, std430) readonly buffer ssbo5 {
+    VP camMats;
+};
+
+struct InstanceData {
+    mat4 model;
+    uint materialID;
+    uint modelMatID;
+};
+
+flat out uint MatID;
+
+layout(binding = 0, std430) readonly buffer ssbo0 {
+    InstanceData data[];
+};
+
+layout(binding = 7, std430) readonly buffer ssbo7 {
+    mat4 modelMat[];
+};
+
+// PackedVertex, 24 bytes: vec3 position, 2x half UV, snorm 10:10:10:2 normal
+// and tangent
+const uint PACKED_VERTEX_WORDS = 6u;
+
+layout(binding = 9, std430) readonly buffer ssbo9 {
+    uint packedVertices[];
+};
+
+vec3 UnpackSnorm10(uint packed)
+{
+    ivec3 v = ivec3(bitfieldExtract(int(packed), 0, 10),
+                    bitfieldExtract(int(packed), 10, 10),
+                    bitfieldExtract(int(packed), 20, 10));
+    return max(vec3(v) / 511.0, vec3(-1.0));
+}
+
+void main()
+{
+uint base = uint(gl_VertexID) * PACKED_VERTEX_WORDS;
+
+vec3 aPos = uintBitsToFloat(uvec3(packedVertices[base],
+                                  packedVertices[base + 1u],
+                                  packedVertices[base + 2u]));
+vec2 aTexCoords = unpackHalf2x16(packedVertices[base + 3u]);
+vec3 aNormal = UnpackSnorm10(packedVertices[base + 4u]);
+
+uint curID = gl_BaseInstance + gl_InstanceID;
+MatID = data[curID] . materialID;
+uint partMat = data[curID].modelMatID;
+TexCoords = aTexCoords;
+
+mat4 model = data[curID] . model * modelMat[partMat];
+FragNormal = normalize(mat3(model) * aNormal);
+
+gl_Position = camMats . projection * camMats . view * model * vec4(aPos, 1.0);
+
+}
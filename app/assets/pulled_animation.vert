@@ -0,0 +1,122 @@
+
+
+#version 460 core
+#extension GL_ARB_bindless_texture : require
+
+// Vertex pulling version of animation.vert, reads the full Vertex layout of
+// BUFFER_ANIMATED_MESH_DATA. Use with BufferManager::SetVertexPulling(true).
+
+// ============================ Vertex Storage ============================
+// Vertex is 23 words: pos 3, uv 2, normal 3, tangent 4, bitangent 3,
+// bone ids 4, bone weights 4. Read as uint so the bone ids keep their bits.
+const uint VERTEX_WORDS = 23u;
+
+layout(std430, binding = 8) readonly buffer ssbo8 {
+    uint vertices[];
+};
+
+vec4 FetchVec4(uint at)
+{
+    return uintBitsToFloat(uvec4(vertices[at], vertices[at + 1u],
+                                 vertices[at + 2u], vertices[at + 3u]));
+}
+
+// ============================ Outputs ============================
+out vec2 TexCoords;
+out vec3 FragNormal;
+flat out uint MatID;
+
+// ============================ Camera (UBO/SSBO) ============================
+struct VP {
+    mat4 view;
+    mat4 projection;
+};
+layout(std430, binding = 5) readonly buffer ssbo5 {
+    VP camMats;
+};
+
+// ============================ Instance Data ============================
+struct InstanceData {
+    mat4 model;
+    uint materialID;
+    uint modelMatID;
+    uint numJoints;
+    uint jointMatLocation; // starting offset into jointMatrices[]
+};
+layout(std430, binding = 0) readonly buffer ssbo0 {
+    InstanceData data[];
+};
+
+// ============================ Bone Matrices ============================
+layout(std430, binding = 2) readonly buffer ssbo2 {
+    mat4 jointMatrices[];
+};
+
+// ============================ Main ============================
+void main()
+{
+    uint base = uint(gl_VertexID) * VERTEX_WORDS;
+
+    vec3 aPos = FetchVec4(base).xyz;
+    vec2 aTexCoords = FetchVec4(base + 3u).xy;
+    vec3 aNormal = FetchVec4(base + 5u).xyz;
+    ivec4 aBoneIDs = ivec4(vertices[base + 15u], vertices[base + 16u],
+                           vertices[base + 17u], vertices[base + 18u]);
+    vec4 aBoneWeights = FetchVec4(base + 19u);
+
+    uint curID = gl_BaseInstance + gl_InstanceID;
+    InstanceData inst = data[curID];
+
+    mat4 model = inst.model;
+    TexCoords = aTexCoords;
+    MatID = inst.materialID;
+
+    // --- Skinning inputs ---
+    vec4 pos = vec4(aPos, 1.0f);
+    vec4 norm = vec4(aNormal, 0.0f);
+
+    vec4 posSkinned = vec4(0.0f);
+    vec4 normSkinned = vec4(0.0f);
+
+    const int MAX_BONE_INFLUENCE = 4;
+
+    // Loop over 4 influences
+    for (int i = 0; i < MAX_BONE_INFLUENCE; ++i)
+    {
+        int id = aBoneIDs[i];
+        float w = aBoneWeights[i];
+
+        // Skip invalid or zero-weight entries
+        if (id < 0 || w <= 0.0f)
+            continue;
+
+        // Apply per-instance joint offset
+        id += int(inst.jointMatLocation);
+
+        // Prevent out-of-bounds indexing
+        if (id >= int(inst.jointMatLocation + inst.numJoints))
+            continue;
+
+        mat4 bone = jointMatrices[id];
+        posSkinned += (bone * pos) * w;
+        normSkinned += (bone * norm) * w;
+    }
+
+    // If no valid weights, use bind pose
+    float totalW = dot(aBoneWeights, vec4(1.0));
+    if (totalW <= 0.0001f) {
+        int safeID = int(data[curID].jointMatLocation);
+        mat4 rootBone = jointMatrices[safeID];
+        posSkinned = rootBone * pos;
+        normSkinned = rootBone * norm;
+    }
+
+    posSkinned.w = 1.0f;
+
+    // --- Transform to world space ---
+    vec4 worldPos = model * posSkinned;
+    FragNormal = normalize(mat3(model) * normSkinned.xyz);
+
+    // --- Clip space ---
+    gl_Position = camMats.projection * camMats.view * worldPos;
+}
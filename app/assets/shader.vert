@@ -40,7 +40,7 @@ layout(binding = 2, std430) readonly buffer ssbo8 {
 
 void main()
 {
-uint curID = gl_DrawID + gl_InstanceID;
+uint curID = gl_BaseInstance + gl_InstanceID;
 MatID = data[curID] . materialID;
 uint partMat = data[curID].modelMatID;
 TexCoords = aTexCoords;
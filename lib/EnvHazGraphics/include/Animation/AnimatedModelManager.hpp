@@ -7,6 +7,7 @@
 #include "Animation/Animator.hpp"
 #include "BufferManager.hpp"
 #include "DataStructs.hpp"
+#include "MeshOptimizer.hpp"
 // #include "MeshManager.hpp"
 #include "ModelPackage.hpp"
 #include "Utils/HashedStrings.hpp"
@@ -22,6 +23,7 @@
 #include <glm/gtc/quaternion.hpp>
 #include <map>
 #include <mutex>
+#include <span>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -157,6 +159,19 @@ public:
 
   void ExportAHazModel(std::string exportPath, ModelID modelID);
 
+  // Mesh optimization run on imported meshes and on .ahzm export
+  void SetMeshOptimizeSettings(const SMeshOptimizeSettings &settings) {
+    meshOptimizeSettings = settings;
+  }
+  const SMeshOptimizeSettings &GetMeshOptimizeSettings() const {
+    return meshOptimizeSettings;
+  }
+
+  // Totals of the last LoadAnimatedModel() or ExportAHazModel() call
+  const SMeshOptimizeStats &GetLastOptimizeStats() const {
+    return lastOptimizeStats;
+  }
+
   ModelID LoadAHazModel(std::string path);
 
   std::vector<ModelID> LoadAHazModelList(std::vector<std::string> paths);
@@ -175,6 +190,13 @@ private:
 
   void ValidateLoadedFiles();
 
+  // uploads the missing meshes of every model in one batch
+  void ValidateLoadedFiles(std::span<const ModelID> models);
+
+  // skeleton/animator setup of one model, queues its meshes for upload
+  void ValidateModelState(ModelID model, std::vector<MeshID> &pendingMeshes,
+                          std::vector<SStaticMeshUpload> &uploads);
+
   std::vector<MeshID> processNode(aiNode *node);
 
   Mesh processMesh(aiMesh *mesh);
@@ -200,6 +222,9 @@ private:
   
   std::mutex mapMutex;
 
+  SMeshOptimizeSettings meshOptimizeSettings;
+  SMeshOptimizeStats lastOptimizeStats;
+
   BufferManager *bufferManager;
 
   std::unordered_map<MeshID, Mesh> meshes;
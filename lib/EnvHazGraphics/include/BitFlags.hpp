@@ -10,6 +10,7 @@ enum class SlotType : uint8_t {
   DYNAMIC_SLOT_1,
   DYNAMIC_SLOT_2,
   DYNAMIC_SLOT_3,
+  DYNAMIC_SLOT_4,
   VERTEX_SLOT,
   INDEX_SLOT
 
@@ -61,6 +62,18 @@ enum class ShaderManagerFlags : uint32_t {
   RESERVED_1 = 1 << 9
 };
 
+// Vertex layout a static geometry container stores, see PackedVertex
+enum class VertexFormat : uint8_t {
+  FULL,  // Vertex as is, bone data included
+  PACKED // PackedVertex, no bitangent and no bone data
+};
+
+// Element type of an index range inside a static geometry container
+enum class IndexType : uint8_t {
+  UINT32,
+  UINT16 // meshes whose indices all fit, half the memory and fetch
+};
+
 enum class SimpleShapes {
 
   SHAPE_CUBE,
@@ -17,16 +17,25 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <glad/glad.h>
 
 #include <optional>
 #include <ratio>
 #include <regex>
+#include <span>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "DataStructs.hpp"
+#include "StaticHeap.hpp"
 #include "StaticStack.hpp"
 #include "DynamicBuffer.hpp"
+#include "InstanceRegistry.hpp"
+#include "StaticMatrixPool.hpp"
+#include "StagingArena.hpp"
+#include "TypedDynamicBuffer.hpp"
 
 namespace eHazGraphics {
 
@@ -224,32 +233,99 @@ public:
         DrawCommandBuffer(std::move(other.DrawCommandBuffer)),
         StaticMeshInformation(std::move(other.StaticMeshInformation)),
         TerrainBuffer(std::move(other.TerrainBuffer)),
+        AnimatedMeshInformation(std::move(other.AnimatedMeshInformation)),
         DynamicBufferIDs(std::move(other.DynamicBufferIDs)),
         StaticbufferIDs(std::move(other.StaticbufferIDs)) {}
 
-  void Initialize(); // NOTE: MAKE INITIAL SIZE VARY DEPENDING ON LAST SESSIONS
-                     // MOST MEMORY USED IN EACH
+  // Buffers are sized from the high-water marks the previous session left in
+  // the buffer profile, see SetBufferProfilePath()
+  void Initialize();
+
+  // Set before Initialize(), an empty path disables the profile
+  void SetBufferProfilePath(const std::string &path) {
+    m_sBufferProfilePath = path;
+  }
 
   void SetStaticStaticUsage(bool p_value) { m_bUseStack = p_value; };
 
   bool IsUsingStaticStack() { return m_bUseStack; }
 
+  // Layout of the static mesh stack, takes effect in Initialize()
+  void SetStaticVertexFormat(VertexFormat format) {
+    m_StaticVertexFormat = format;
+  }
+
+  // Vertex pulling: static geometry is bound as shader storage and the vertex
+  // shader fetches by gl_VertexID, the per-buffer VAOs are not used. Needs
+  // shaders written for it, see app/assets/pulled.vert
+  void SetVertexPulling(bool p_value) { m_bVertexPulling = p_value; }
+  bool IsVertexPulling() const { return m_bVertexPulling; }
+
+  // Storage bindings while pulling, after the dynamic buffers' 0-7
+  static constexpr GLuint PULL_BINDING_FULL_VERTICES = 8;
+  static constexpr GLuint PULL_BINDING_PACKED_VERTICES = 9;
+  static constexpr GLuint PULL_BINDING_INDICES = 10;
+
+  static GLuint GetPullBinding(VertexFormat format) {
+    return format == VertexFormat::PACKED ? PULL_BINDING_PACKED_VERTICES
+                                          : PULL_BINDING_FULL_VERTICES;
+  }
+
+  // Stored bytes per vertex of the buffer a vertex range lives in
+  size_t GetVertexStride(const SBufferRange &range) {
+    if (CGLStaticStack *stack = GetStaticStack(range.handle.bufferID))
+      return stack->GetVertexStride();
+    return sizeof(Vertex);
+  }
+
   void BeginWritting();
 
   void BindDynamicBuffer(TypeFlags type);
 
+  // Start of the region BindDynamicBuffer() selects, for targets bound without
+  // a range (GL_DRAW_INDIRECT_BUFFER)
+  size_t GetBoundSlotOffset(TypeFlags type);
+
   VertexIndexInfoPair InsertNewStaticData(const Vertex *vertexData,
                                           size_t vertexDataSize,
                                           const GLuint *indexData,
                                           size_t indexDataSize, TypeFlags type);
 
+  // Batched form for loading many meshes at once: the target buffer grows at
+  // most once and the data goes up in one copy, pairs match meshes by index
+  std::vector<VertexIndexInfoPair>
+  InsertNewStaticData(std::span<const SStaticMeshUpload> meshes,
+                      TypeFlags type);
+
   SBufferRange InsertNewDynamicData(const void *data, size_t size,
                                     TypeFlags type);
 
+  // Copies the instances of every arena into one contiguous range of
+  // BUFFER_INSTANCE_DATA and sets each arena's base instance. Main thread only,
+  // after the workers are done recording.
+  SBufferRange MergeStagingArenas(std::span<CStagingArena *const> arenas);
+
+  // Typed view over one of the dynamic buffers, e.g.
+  // GetTypedBuffer<TypeFlags::BUFFER_INSTANCE_DATA>().Insert(instance)
+  template <TypeFlags Flag> TypedBufferFor<Flag> GetTypedBuffer() {
+    return TypedBufferFor<Flag>(GetDynamicBuffer(Flag));
+  }
+
   void ClearBuffer(TypeFlags whichBuffer);
 
   void BindStaticBuffer(TypeFlags buffer) {
 
+    if (m_bVertexPulling) {
+      BindPulledGeometry(buffer);
+      return;
+    }
+
+    // skinned geometry has its own stack in both modes
+    if (buffer == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+      AnimatedMeshInformation.BindBuffer();
+      return;
+    }
+
     if (m_bUseStack) {
       switch (buffer) {
       case TypeFlags::BUFFER_STATIC_MESH_DATA:
@@ -262,58 +338,117 @@ public:
         SDL_Log("Failed to bind static buffer, unknown TypeFlag given to "
                 "BindStaticBuffer()\n");
       }
-    } else {
-      // TODO: IMPLEMENT
+    } else if (StaticMeshHeap.IsCreated()) {
+      // terrain shares the mesh heap for the same reason it shares the stack
+      StaticMeshHeap.BindBuffer();
     }
   }
 
   // Removes a range from the dynamic buffer , i recomend you dont use this
-  
+  void RemoveRange(const SBufferRange &range);
+
+  // Sub-allocator state of the write slot of a dynamic buffer
+  std::optional<SFragmentationStats> GetFragmentationStats(TypeFlags type);
+
+  // Stalling vs stall free growth of a dynamic buffer
+  std::optional<SResizeStats> GetResizeStats(TypeFlags type);
 
   void InvalidateStaticRange(const VertexIndexInfoPair &p_pair) {
 
-    for (auto &buffer : StaticbufferIDs) {
-      if (buffer->GetStaticStackID() == p_pair.first.handle.bufferID) {
-        buffer->InvalidateRange(p_pair);
-      }
+    const uint32_t bufferID = p_pair.first.handle.bufferID;
+    if (CGLStaticStack *buffer = GetStaticStack(bufferID)) {
+      buffer->InvalidateRange(p_pair);
+    } else if (bufferID < m_BufferLookup.size() &&
+               m_BufferLookup[bufferID].staticHeap != nullptr) {
+      m_BufferLookup[bufferID].staticHeap->InvalidateRange(p_pair);
     }
   }
 
   void UpdateData(SBufferRange &range, const void *data,
                   const size_t size);
 
+  // bufferIDs index m_BufferLookup directly, no scanning over the buffers
   std::optional<SAllocation> GetAllocation(const SBufferRange &range) {
 
-    if (m_bUseStack) {
+    const uint32_t bufferID = range.handle.bufferID;
+    if (bufferID >= m_BufferLookup.size()) {
+      return std::nullopt;
+    }
 
-      for (auto &buffer : StaticbufferIDs) {
+    const SBufferLookupEntry &entry = m_BufferLookup[bufferID];
 
-        if (buffer->GetStaticStackID() == range.handle.bufferID) {
+    if (entry.staticStack != nullptr) {
+      return entry.staticStack->GetAllocation(range);
+    }
+    if (entry.staticHeap != nullptr) {
+      return entry.staticHeap->GetAllocation(range);
+    }
+    if (entry.dynamicBuffer != nullptr) {
+      return entry.dynamicBuffer->GetAllocation(range.handle.allocationID);
+    }
 
-          return buffer->GetAllocation(range);
-        }
-      }
-    } else {
+    return std::nullopt;
+  }
 
-      // TODO: IMPLEMENT
-    }
-    for (auto &buffer : DynamicBufferIDs) {
+  // Resolves ranges[i] into allocations[i], both spans must be the same size
+  void GetAllocations(std::span<const SBufferRange> ranges,
+                      std::span<std::optional<SAllocation>> allocations);
 
-      if (buffer->GetBufferID() == range.handle.bufferID) {
+  // Retained per-instance slots inside BUFFER_INSTANCE_DATA
+  CInstanceRegistry &GetInstanceRegistry() { return InstanceRegistry; }
 
-        return *buffer->GetAllocation(range.handle.allocationID);
-      }
+  // Relative mesh matrices inside BUFFER_STATIC_MATRIX_DATA, keyed by MeshID
+  CStaticMatrixPool &GetStaticMatrixPool() { return StaticMatrixPool; }
+
+  // Appends capacity/occupied/wasted bytes of every buffer, cheap enough to
+  // call once per frame
+  void GetMemoryStats(std::vector<SBufferMemoryStats> &stats) const;
+
+  // Called whenever a static stack finished compacting, anything holding
+  // static VertexIndexInfoPairs patches them with SStaticRemapTable::Apply()
+  using StaticRemapListener = std::function<void(const SStaticRemapTable &)>;
+  void AddStaticRemapListener(StaticRemapListener listener) {
+    m_StaticRemapListeners.push_back(std::move(listener));
+  }
+
+  // Changes whenever a compaction step moved static data, handles stay valid
+  // but offsets baked into draw commands have to be rebuilt
+  uint32_t GetStaticLayoutVersion() const {
+    uint32_t version = 0;
+    for (const CGLStaticStack *stack : StaticbufferIDs) {
+      version += stack->GetLayoutVersion();
     }
+    return version;
+  }
+
+  // A stack starts compacting once its dead bytes pass deadFraction of its
+  // used bytes (0 only compacts on request), bytesPerFrame caps the moves
+  void SetStaticCompaction(float deadFraction, size_t bytesPerFrame) {
+    m_fCompactionDeadFraction = deadFraction;
+    m_szCompactionBytesPerFrame = bytesPerFrame;
   }
 
+  void RequestStaticCompaction(TypeFlags type);
+
   void EndWritting();
 
+  // after the frame's draws, fences the slots EndWritting() handed to the GPU
+  void FenceWrittenSlots();
+
   void UpdateManager();
 
   void Destroy();
 
 private:
   bool m_bUseStack = true;
+  bool m_bVertexPulling = false;
+
+  // attribute-less VAO for vertex pulling, only holds the element buffer
+  GLuint m_glPullVertexArray = 0;
+  void BindPulledGeometry(TypeFlags buffer);
+  // skinned meshes live in AnimatedMeshInformation, so static geometry does
+  // not need the bone attributes
+  VertexFormat m_StaticVertexFormat = VertexFormat::PACKED;
 
   CDynamicBuffer InstanceData;
   CDynamicBuffer AnimationMatrices;
@@ -324,8 +459,17 @@ private:
   CDynamicBuffer LightsBuffer;
   CDynamicBuffer StaticMatrices;
 
+  CInstanceRegistry InstanceRegistry;
+  CStaticMatrixPool StaticMatrixPool;
+
   CGLStaticStack StaticMeshInformation;
   CGLStaticStack TerrainBuffer;
+  CGLStaticStack AnimatedMeshInformation; // full Vertex incl. bone data
+
+  // static geometry when m_bUseStack is false, created on first use
+  CGLStaticHeap StaticMeshHeap;
+  static constexpr uint32_t STATIC_HEAP_ID = 11;
+  CGLStaticHeap &GetStaticHeap();
   // StaticBuffer StaticMatrices;
   //  Every time a buffer is added update the following functions:
   //  Initialize(), InsertNew*Data() , ClearBuffer() and BitFlags
@@ -334,11 +478,56 @@ private:
 
   // CHANGE THESE EVERYTIME YOU ADD A BUFFER!!!!!!!!!
   unsigned int numOfDynamicBuffers = 8;
-  unsigned int numofStaticBuffers = 2;
+  unsigned int numofStaticBuffers = 3;
 
   std::vector<CGLStaticStack *> StaticbufferIDs;
   std::vector<CDynamicBuffer *> DynamicBufferIDs;
 
+  CDynamicBuffer *GetDynamicBuffer(TypeFlags type);
+
+  struct SBufferProfileEntry {
+    size_t size = 0;
+    size_t indexSize = 0; // static stacks only
+  };
+
+  std::string m_sBufferProfilePath = "EnvHazBufferProfile.txt";
+  std::unordered_map<uint32_t, SBufferProfileEntry> m_BufferProfile;
+
+  void LoadBufferProfile();
+  void SaveBufferProfile();
+  size_t GetProfiledSize(TypeFlags type, size_t fallback,
+                         bool indexBuffer = false) const;
+
+  struct SBufferLookupEntry {
+    CDynamicBuffer *dynamicBuffer = nullptr;
+    CGLStaticStack *staticStack = nullptr;
+    CGLStaticHeap *staticHeap = nullptr;
+  };
+
+  // indexed by SBufferHandle::bufferID, built in Initialize()
+  std::vector<SBufferLookupEntry> m_BufferLookup;
+
+  void BuildBufferLookup();
+
+  // runs one compaction step per static stack, from BeginWritting()
+  void StepStaticCompaction();
+
+  std::vector<StaticRemapListener> m_StaticRemapListeners;
+  float m_fCompactionDeadFraction = 0.25f;
+  size_t m_szCompactionBytesPerFrame = MBsize(4);
+
+  CDynamicBuffer *GetDynamicBuffer(uint32_t bufferID) {
+    return bufferID < m_BufferLookup.size()
+               ? m_BufferLookup[bufferID].dynamicBuffer
+               : nullptr;
+  }
+
+  CGLStaticStack *GetStaticStack(uint32_t bufferID) {
+    return bufferID < m_BufferLookup.size()
+               ? m_BufferLookup[bufferID].staticStack
+               : nullptr;
+  }
+
   // std::unordered_map<MeshID, >
 };
 
@@ -6,9 +6,11 @@
 #include "stbi_image.h"
 #include <SDL3/SDL_log.h>
 #include <boost/serialization/access.hpp>
+#include <boost/serialization/version.hpp>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <algorithm>
 #include <string>
 #include <utility>
 #include <vector>
@@ -35,6 +37,35 @@ struct SBufferRange {
   SBufferHandle handle;
   TypeFlags dataType;
   uint32_t count;
+  IndexType indexType = IndexType::UINT32; // index ranges only
+};
+
+inline size_t GetIndexSize(IndexType p_Type) {
+  return p_Type == IndexType::UINT16 ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+inline GLenum GetGLIndexType(IndexType p_Type) {
+  return p_Type == IndexType::UINT16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+// GPU memory held by one buffer, see BufferManager::GetMemoryStats()
+struct SBufferMemoryStats {
+  TypeFlags type = TypeFlags::BUFFER_STATIC_DATA;
+  size_t capacityBytes = 0; // everything allocated from the driver
+  size_t occupiedBytes = 0; // bytes of live allocations
+  size_t wastedBytes = 0;   // holes, alignment padding and retired storage
+};
+
+// Stable handle into CInstanceRegistry, survives frames until released.
+struct SInstanceHandle {
+  uint32_t index = INVALID_ALLOCATION;
+  uint32_t generation = 0;
+};
+
+// Persistent static draw command inside the RenderQueue
+struct SRenderCommandHandle {
+  uint32_t index = INVALID_ALLOCATION;
+  uint32_t generation = 0;
 };
 
 class CopyDataPtr {
@@ -144,15 +175,93 @@ struct Vertex {
   }
 };
 
+// 24 byte layout of VertexFormat::PACKED, decoded by the vertex fetch so
+// shaders read it like the full Vertex
+struct PackedVertex {
+  glm::vec3 Position;
+  uint32_t UV;      // 2x half float
+  uint32_t Normal;  // snorm 10:10:10:2
+  uint32_t Tangent; // snorm 10:10:10:2, w holds the bitangent sign
+};
+
+// One mesh of a batched InsertNewStaticData(), sizes in bytes like the
+// single mesh overload
+struct SStaticMeshUpload {
+  const Vertex *vertexData = nullptr;
+  size_t vertexDataSize = 0;
+  const GLuint *indexData = nullptr;
+  size_t indexDataSize = 0;
+};
+
+// Object space bounds of a mesh, the sphere is centred on the box. A negative
+// radius means they were never computed.
+struct SBounds {
+  glm::vec3 min = glm::vec3(0.0f);
+  glm::vec3 max = glm::vec3(0.0f);
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = -1.0f;
+
+  bool IsValid() const { return radius >= 0.0f; }
+
+  template <class Archive>
+  void serialize(Archive &ar, const unsigned int version) {
+    ar & min;
+    ar & max;
+    ar & center;
+    ar & radius;
+  }
+};
+
 class MeshData {
 public:
   std::vector<Vertex> vertices;
 
   std::vector<GLuint> indecies;
+
+  SBounds bounds;
+
   template <class Archive>
   void serialize(Archive &ar, const unsigned int version) {
     ar & vertices;
     ar & indecies;
+
+    if (version > 0)
+      ar & bounds;
+  }
+};
+
+// Contiguous run of a mesh's indices that can be culled and drawn on its own.
+// The cone contains every triangle normal, coneCutoff is the sine of its
+// spread and stays 1 when the cluster faces too many ways to be back facing.
+struct SMeshlet {
+  uint32_t firstIndex = 0; // relative to the start of the mesh's indices
+  uint32_t indexCount = 0;
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = 0.0f;
+  glm::vec3 coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+  float coneCutoff = 1.0f;
+
+  template <class Archive>
+  void serialize(Archive &ar, const unsigned int version) {
+    ar & firstIndex;
+    ar & indexCount;
+    ar & center;
+    ar & radius;
+    ar & coneAxis;
+    ar & coneCutoff;
+  }
+};
+
+// A reduced level of detail of a mesh, error is how far in object space it
+// strays from the full mesh
+struct SMeshLOD {
+  MeshData data;
+  float error = 0.0f;
+
+  template <class Archive>
+  void serialize(Archive &ar, const unsigned int version) {
+    ar & data;
+    ar & error;
   }
 };
 
@@ -191,6 +300,8 @@ public:
   GLuint64 TextureHandle;
   GLuint texture;
   int width, height, nrChannel;
+  int levels = 1;
+  GLenum internalFormat = GL_RGBA8;
   unsigned char *data;
 
   Texture2D(std::string texturePath, GLenum storageFormat = 0,
@@ -224,9 +335,11 @@ public:
       }
     }
 
+    internalFormat = storageFormat;
+
     glCreateTextures(GL_TEXTURE_2D, 1, &texture);
 
-    glTextureStorage2D(texture, 1, storageFormat, width, height);
+    glTextureStorage2D(texture, levels, storageFormat, width, height);
     glTextureSubImage2D(texture, 0, 0, 0, width, height, imageFormat,
                         GL_UNSIGNED_BYTE, (const void *)&data[0]);
     glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -253,6 +366,31 @@ public:
 
   int GetNrChannels() const { return nrChannel; }
 
+  // Bytes of the allocated storage summed over every mip level. RGB8 is
+  // counted as 4 bytes per texel since drivers pad it.
+  size_t GetMemorySize() const {
+    size_t texelSize = 4;
+    switch (internalFormat) {
+    case GL_R8:
+      texelSize = 1;
+      break;
+    case GL_RG8:
+      texelSize = 2;
+      break;
+    default:
+      break;
+    }
+
+    size_t bytes = 0;
+    size_t w = width, h = height;
+    for (int level = 0; level < levels; level++) {
+      bytes += w * h * texelSize;
+      w = std::max<size_t>(1, w / 2);
+      h = std::max<size_t>(1, h / 2);
+    }
+    return bytes;
+  }
+
   int GetTexture() const { return texture; }
 
   int GetTextureHandle() const { return TextureHandle; }
@@ -312,8 +450,16 @@ struct DrawRange {
   size_t startIndex;
   size_t count;
   ShaderComboID shader;
+  TypeFlags geometry = TypeFlags::BUFFER_STATIC_MESH_DATA; // VAO to bind
+  GLenum indexType = GL_UNSIGNED_INT;
+  // startIndex counts from the persistent region of the draw command slot
+  // instead of this frame's command range
+  bool persistent = false;
 };
 
 }; // namespace eHazGraphics
 
+// version 1 added the bounds, older packages compute them when loaded
+BOOST_CLASS_VERSION(eHazGraphics::MeshData, 1)
+
 #endif
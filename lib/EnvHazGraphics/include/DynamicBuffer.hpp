@@ -6,8 +6,36 @@
 #include <cstdint>
 #include "DataStructs.hpp"
 #include <optional>
+#include <map>
+#include <vector>
 namespace eHazGraphics {
 
+	// Snapshot of the sub-allocator state of the current write slot.
+	struct SFragmentationStats
+	{
+		size_t usedBytes = 0;
+		size_t freeBytes = 0; // holes below the write cursor
+		size_t largestFreeBlock = 0;
+		uint32_t freeBlockCount = 0;
+		uint64_t inPlaceUpdates = 0;
+		uint64_t reallocatedUpdates = 0;
+
+		// 0 when all free space is one block, approaches 1 as it splinters
+		float GetFragmentation() const
+		{
+			return freeBytes == 0 ? 0.0f : 1.0f - float(largestFreeBlock) / float(freeBytes);
+		}
+	};
+
+	// How often growing the buffer had to block the CPU. A resize only stalls
+	// when something is written over bytes its GPU side copy has not finished.
+	struct SResizeStats
+	{
+		uint64_t stallFreeResizes = 0;
+		uint64_t stallingResizes = 0;
+		uint32_t pendingRetirements = 0; // old buffers still waiting on the GPU
+	};
+
 
 	class CDynamicBuffer
 	{
@@ -15,24 +43,69 @@ namespace eHazGraphics {
 
 		CDynamicBuffer();
 
+		// Each of the p_uiRingDepth slots is a region of one persistently
+		// mapped buffer, p_szInitialSize is the size of a single region.
 		CDynamicBuffer(size_t p_szInitialSize, int p_iDynamicBufferID,
-			GLenum p_gleTarget = GL_SHADER_STORAGE_BUFFER, bool p_bTrippleBuffer = true);
+			GLenum p_gleTarget = GL_SHADER_STORAGE_BUFFER, uint32_t p_uiRingDepth = 3);
 
-
-		
-		template<typename T>
-		SBufferRange InsertNewData(const T* p_pData, size_t p_szSize, TypeFlags p_tfType);
+		static constexpr uint32_t MAX_RING_DEPTH = 4;
 
 
 
 		SBufferRange InsertNewData(const void* p_pData, size_t p_szSize, TypeFlags p_tfType);
 
+		// Allocates in the write slot without writing anything, fill it with
+		// WriteRange() at the allocation offset
+		SBufferRange ReserveRange(size_t p_szSize, TypeFlags p_tfType);
+
+		// Same as ReserveRange() when the element count is already known, used
+		// by CTypedDynamicBuffer so no TypeFlags switch runs per insert
+		SBufferRange ReserveElements(size_t p_szSize, uint32_t p_uiCount, TypeFlags p_tfType);
+
+		// Overwrites the range in place when it lives in the write slot and still
+		// fits, otherwise the old block is freed and the data re-allocated.
 		void UpdateRange(SBufferRange* p_brRange, const void* p_pData, size_t p_szDataSize);
 
+		// Returns the block to the free list of the write slot, merging it with
+		// its free neighbours.
+		void RemoveItem(const SBufferRange& p_brRange);
+
+		SFragmentationStats GetFragmentationStats() const;
+
+		// Grows every slot without waiting on the GPU, see GetResizeStats()
 		void ResizeBuffer(size_t p_szMinimumSize = 1024UL);
 
+		SResizeStats GetResizeStats() const;
+
+		// Capacity of every region plus retired buffers, occupied bytes of all
+		// slots, the type is left for the owner to fill in
+		SBufferMemoryStats GetMemoryStats() const;
+
 		void ClearBuffer();
 
+		// Bytes [0, p_szSize) of every slot are kept across ClearBuffer() so
+		// long lived data (see CInstanceRegistry) does not have to be
+		// re-inserted each frame. Can only grow while the write slot holds no
+		// transient data, returns false otherwise.
+		bool ReservePersistentRegion(size_t p_szSize);
+
+		// Writes straight into the current write slot at a byte offset.
+		void WriteRange(size_t p_szOffset, const void* p_pData, size_t p_szSize);
+
+		size_t GetPersistentRegionSize() const { return m_szPersistentSize; }
+
+		// Largest write cursor any slot reached since construction
+		size_t GetHighWaterMark() const { return m_szHighWaterMark; }
+
+		uint32_t GetSlotCount() const { return m_uiRingDepth; }
+
+		// Byte offset of a slot's region inside the GL buffer, needed by the
+		// non indexed targets (e.g. the indirect offset of draw calls)
+		size_t GetSlotBaseOffset(int p_Slot) const { return p_Slot * m_szRegionStride; }
+
+		// Frames that found no free region and had to wait on the GPU
+		uint64_t GetForcedWaitCount() const { return m_uiForcedWaits; }
+
 
 		std::optional<SAllocation> GetAllocation(int p_AllocationID);
 
@@ -52,12 +125,42 @@ namespace eHazGraphics {
 
 		void EndWritting();
 
+		// Fences the slot EndWritting() made current, call after the last
+		// command reading it so BeginWritting() does not reuse it too early
+		void FenceCurrentSlot();
+
 		void Destroy();
 
 	private:
 
 
 		std::vector<SAllocation> m_Allocations;
+		std::vector<uint32_t> m_FreeAllocationIDs;
+
+		// free blocks of the write slot, kept both by offset (for coalescing)
+		// and by size (for best fit lookups)
+		std::map<size_t, size_t> m_FreeBlocks;
+		std::multimap<size_t, size_t> m_FreeBlocksBySize;
+
+		uint64_t m_uiInPlaceUpdates = 0;
+		uint64_t m_uiReallocatedUpdates = 0;
+
+		// buffers replaced by ResizeBuffer(), deleted once the GPU is done
+		struct SRetiredBuffer
+		{
+			GLuint buffer = 0;
+			GLsync fence = 0;
+			size_t size = 0;
+		};
+		std::vector<SRetiredBuffer> m_RetiredBuffers;
+
+		// pending GPU copy of the old contents into the resized regions
+		GLsync m_glsCopyFence = 0;
+		size_t m_szCopyLimit[MAX_RING_DEPTH] = {};
+
+		uint64_t m_uiResizeCount = 0;
+		uint64_t m_uiStallingResizes = 0;
+		bool m_bResizeStalled = false;
 
 
 
@@ -66,12 +169,17 @@ namespace eHazGraphics {
 
 		uint32_t m_uiDynamicBufferID;
 		
-		GLuint m_uiSlotIDs[3]{ 0,0,0 };
-		void* m_pSlots[3]{ nullptr,nullptr,nullptr };
-		size_t m_szBufferSize{0};
-		size_t m_szWriteCursor[3] = {};
-		size_t m_szOccupiedSize[3] = {};
-		GLsync m_glsFences[3]{ 0,0,0 };
+		GLuint m_uiBufferObject = 0;
+		void* m_pMapped = nullptr;
+		void* m_pSlots[MAX_RING_DEPTH]{ nullptr,nullptr,nullptr,nullptr };
+		size_t m_szBufferSize{0}; // usable size of one region
+		size_t m_szRegionStride{0}; // m_szBufferSize rounded up to the bind alignment
+		size_t m_szRegionAlignment{256};
+		size_t m_szWriteCursor[MAX_RING_DEPTH] = {};
+		size_t m_szOccupiedSize[MAX_RING_DEPTH] = {};
+		size_t m_szPersistentSize{0};
+		size_t m_szHighWaterMark{0};
+		GLsync m_glsFences[MAX_RING_DEPTH]{ 0,0,0,0 };
 		
 		int m_iBinding = 0;
 		int m_iCurrentSlot = 0;
@@ -79,19 +187,34 @@ namespace eHazGraphics {
 
 		bool m_bSlotResizeState{false};
 
-		bool m_bUseTrippleBuffering = true;
+		uint32_t m_uiRingDepth = 3;
+		uint64_t m_uiForcedWaits = 0;
 
 		uint64_t m_uiSlotTimeLine = 0;
-		uint64_t m_uiSlotAge[3]{ 0,0,0 };
+		uint64_t m_uiSlotAge[MAX_RING_DEPTH]{ 0,0,0,0 };
 
 
 		uint32_t AllocateID(size_t p_szMinimumSize);
+
+		size_t AllocateRange(size_t p_szSize);
+		void ReleaseRange(size_t p_szOffset, size_t p_szSize);
+		void InsertFreeBlock(size_t p_szOffset, size_t p_szSize);
+		void EraseFreeBlock(std::map<size_t, size_t>::iterator p_it);
+		void ResetFreeBlocks();
+
+		// mapped write slot pointer, waits for a pending resize copy only if
+		// p_szOffset falls inside the bytes it still has to land
+		std::byte* GetWritePointer(size_t p_szOffset);
+		void ReleaseRetiredBuffers();
+
+		bool IsLiveAllocation(const SBufferHandle& p_Handle) const;
 		
 		SlotType GetDynamicSlotType(int p_ID);
 		int GetDynamicSlotID(SlotType p_type);
 
 		void SetDownFence(int p_Slot);
 		void MapAllBufferSlots();
+		size_t AlignRegionSize(size_t p_szSize) const;
 		bool WaitForSlotFence(int p_Slot);
 		
 
@@ -0,0 +1,65 @@
+#ifndef EHAZ_GRAPHICS_FRUSTUM_CULLER_HPP
+#define EHAZ_GRAPHICS_FRUSTUM_CULLER_HPP
+
+#include "DataStructs.hpp"
+#include <array>
+#include <cstdint>
+
+namespace eHazGraphics {
+
+// Six planes facing inwards with normalized xyz, a point is inside when
+// dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct SFrustum {
+  std::array<glm::vec4, 6> planes;
+};
+
+struct SCullStats {
+  uint32_t tested = 0;
+  uint32_t visible = 0;
+  uint32_t culled = 0;
+};
+
+// Tests world space bounding spheres against the camera frustum before draw
+// commands are built. Until a view is set every sphere passes.
+class CFrustumCuller {
+public:
+  CFrustumCuller() = default;
+
+  // Gribb/Hartmann plane extraction from projection * view, GL clip space
+  void SetViewProjection(const glm::mat4 &p_ViewProjection);
+
+  void SetEnabled(bool p_bEnabled) { m_bEnabled = p_bEnabled; }
+  bool IsEnabled() const { return m_bEnabled && m_bHasFrustum; }
+
+  const SFrustum &GetFrustum() const { return m_Frustum; }
+
+  bool TestSphere(const glm::vec3 &p_Center, float p_fRadius);
+
+  // Structure of arrays batch, p_pVisible gets 1 for every sphere touching
+  // the frustum. Runs 8 spheres at a time with AVX, 4 with SSE. Returns the
+  // visible count.
+  size_t CullSpheres(const float *p_pX, const float *p_pY, const float *p_pZ,
+                     const float *p_pRadius, size_t p_szCount,
+                     uint8_t *p_pVisible);
+
+  // Counters of the frame that just ended, call once per frame
+  void EndFrame();
+  const SCullStats &GetStats() const { return m_LastStats; }
+
+private:
+  SFrustum m_Frustum{};
+  bool m_bEnabled = true;
+  bool m_bHasFrustum = false;
+
+  SCullStats m_Stats;
+  SCullStats m_LastStats;
+};
+
+// World space sphere of p_Bounds under p_World, the radius is scaled by the
+// largest axis. Invalid bounds give an infinite radius that is never culled.
+void TransformBoundingSphere(const SBounds &p_Bounds, const glm::mat4 &p_World,
+                             glm::vec3 &p_Center, float &p_fRadius);
+
+} // namespace eHazGraphics
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef EHAZ_GRAPHICS_GPU_CULLER_HPP
+#define EHAZ_GRAPHICS_GPU_CULLER_HPP
+
+#include "DataStructs.hpp"
+#include "FrustumCuller.hpp"
+#include <cstdint>
+#include <span>
+
+namespace eHazGraphics {
+
+// Compute pass that frustum culls a fixed list of draw commands every frame
+// and compacts the visible ones of each DrawRange to the range's start, with
+// the count written for glMultiDrawElementsIndirectCount. The commands are
+// only uploaded when they change, the instances are read from the instance
+// SSBO at binding 0, so moving an instance needs no CPU work here.
+class CGPUCuller {
+public:
+  CGPUCuller() = default;
+
+  // Needs the GL context, false when the compute programme did not build
+  bool Initialize();
+
+  void Destroy();
+
+  bool IsInitialized() const { return m_uiProgram != 0; }
+
+  // p_Bounds holds one model space sphere per command (xyz centre, w radius,
+  // negative never culls), p_CommandRanges the (range index, first command of
+  // the range) of every command.
+  void SetCommands(std::span<const DrawElementsIndirectCommand> p_Commands,
+                   std::span<const glm::vec4> p_Bounds,
+                   std::span<const glm::uvec2> p_CommandRanges,
+                   uint32_t p_uiRangeCount);
+
+  // Run once per frame after the instance buffer is bound
+  void Dispatch(const SFrustum &p_Frustum);
+
+  // Binds the compacted commands and the counts for DrawCulledRange()
+  void BindForDrawing() const;
+
+  // p_Range is the range's index among the uploaded ranges
+  void DrawCulledRange(uint32_t p_uiRange, const DrawRange &p_Range) const;
+
+  uint32_t GetCommandCount() const { return m_uiCommandCount; }
+
+private:
+  // grows p_Buffer to hold p_szSize bytes, the contents are not kept
+  static void Reserve(GLuint &p_Buffer, size_t &p_szCapacity, size_t p_szSize);
+
+  GLuint m_uiProgram = 0;
+  GLint m_iPlanesLocation = -1;
+  GLint m_iCommandCountLocation = -1;
+
+  GLuint m_uiInputCommands = 0;
+  GLuint m_uiBounds = 0;
+  GLuint m_uiCommandRanges = 0;
+  GLuint m_uiOutputCommands = 0;
+  GLuint m_uiDrawCounts = 0;
+
+  size_t m_szInputCapacity = 0;
+  size_t m_szBoundsCapacity = 0;
+  size_t m_szRangesCapacity = 0;
+  size_t m_szOutputCapacity = 0;
+  size_t m_szCountsCapacity = 0;
+
+  uint32_t m_uiCommandCount = 0;
+  uint32_t m_uiRangeCount = 0;
+};
+
+} // namespace eHazGraphics
+
+#endif
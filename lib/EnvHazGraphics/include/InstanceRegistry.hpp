@@ -0,0 +1,77 @@
+#ifndef EHAZ_GRAPHICS_INSTANCE_REGISTRY_HPP
+#define EHAZ_GRAPHICS_INSTANCE_REGISTRY_HPP
+
+#include "DataStructs.hpp"
+#include "DynamicBuffer.hpp"
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace eHazGraphics {
+
+// Retained InstanceData living in the persistent region of the instance
+// CDynamicBuffer. An instance is registered once and keeps its GPU index;
+// changes only mark it dirty and it gets rewritten into each ring slot the next
+// time that slot is written, instead of being re-inserted every frame.
+class CInstanceRegistry {
+public:
+  CInstanceRegistry();
+
+  CInstanceRegistry(CDynamicBuffer *p_pInstanceBuffer,
+                    uint32_t p_uiInitialCapacity);
+
+  SInstanceHandle Register(const InstanceData &p_Data);
+
+  void Update(const SInstanceHandle &p_Handle, const InstanceData &p_Data);
+
+  void SetTransform(const SInstanceHandle &p_Handle,
+                    const glm::mat4 &p_Transform);
+
+  void Release(const SInstanceHandle &p_Handle);
+
+  bool IsValid(const SInstanceHandle &p_Handle) const;
+
+  std::optional<InstanceData> Get(const SInstanceHandle &p_Handle) const;
+
+  // Element index into the instance SSBO for this frame (baseInstance).
+  uint32_t GetGPUIndex(const SInstanceHandle &p_Handle);
+
+  // Call right after the instance buffer moved to a new write slot.
+  void Flush();
+
+  void Clear();
+
+  uint32_t GetLiveCount() const { return m_uiLiveCount; }
+  uint32_t GetDirtyCount() const {
+    return static_cast<uint32_t>(m_DirtyIndices.size());
+  }
+  uint32_t GetCapacity() const { return m_uiCapacity; }
+
+private:
+  void MarkDirty(uint32_t p_uiIndex);
+  void WriteToWriteSlot(uint32_t p_uiIndex);
+  uint8_t GetWriteSlotBit() const;
+
+  CDynamicBuffer *m_pInstanceBuffer = nullptr;
+
+  std::vector<InstanceData> m_Instances;
+  std::vector<uint32_t> m_Generations;
+  std::vector<uint8_t> m_DirtySlots; // one bit per ring slot still stale
+  std::vector<bool> m_Alive;
+
+  std::vector<uint32_t> m_FreeIndices;
+  std::vector<uint32_t> m_DirtyIndices;
+
+  // instances registered past the reserved region this frame, drawn from a
+  // transient copy until Flush() grows the region
+  std::unordered_map<uint32_t, SBufferRange> m_FallbackRanges;
+
+  uint32_t m_uiCapacity = 0;
+  uint32_t m_uiLiveCount = 0;
+  uint8_t m_uiAllSlotsMask = 0;
+};
+
+} // namespace eHazGraphics
+
+#endif
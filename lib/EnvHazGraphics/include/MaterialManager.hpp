@@ -3,6 +3,7 @@
 
 #include "BitFlags.hpp"
 #include "DataStructs.hpp"
+#include "MemoryBudget.hpp"
 #include "Utils/HashedStrings.hpp"
 #include <memory>
 #include <optional>
@@ -37,6 +38,18 @@ public:
 
   void ClearMaterials();
 
+  // Bytes of every loaded texture including mips, kept up to date on load
+  STextureMemoryStats GetTextureMemoryStats() const {
+    return STextureMemoryStats{static_cast<uint32_t>(LoadedTextures.size()),
+                               m_szTextureBytes};
+  }
+
+  size_t GetTextureMemorySize(unsigned int textureID) const {
+    return textureID < LoadedTextures.size()
+               ? LoadedTextures[textureID]->GetMemorySize()
+               : 0;
+  }
+
   void DeleteMaterial(
       unsigned int MaterialID); // probably shouldnt have this here since
                                 // again... alignement is a b*%#
@@ -52,6 +65,8 @@ private:
 
   std::unordered_map<eHazGraphics_Utils::HashedString, unsigned int>
       MaterialNames;
+
+  size_t m_szTextureBytes = 0;
 };
 
 } // namespace eHazGraphics
@@ -0,0 +1,63 @@
+#ifndef EHAZ_GRAPHICS_MEMORY_BUDGET_HPP
+#define EHAZ_GRAPHICS_MEMORY_BUDGET_HPP
+
+#include "DataStructs.hpp"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace eHazGraphics {
+
+struct STextureMemoryStats {
+  uint32_t textureCount = 0;
+  size_t bytes = 0; // all mip levels
+};
+
+// Everything the renderer holds on the GPU, rebuilt once per frame
+struct SMemoryReport {
+  std::vector<SBufferMemoryStats> buffers;
+  STextureMemoryStats textures;
+
+  size_t GetBufferBytes() const;
+  size_t GetWastedBytes() const;
+  size_t GetTotalBytes() const { return GetBufferBytes() + textures.bytes; }
+};
+
+// Compares each frame's SMemoryReport against a byte budget and runs the
+// eviction callbacks, in registration order, while the report is over it.
+class CMemoryBudget {
+public:
+  // Gets the report and how many bytes it is over the budget, returns how
+  // many bytes it expects to have released
+  using EvictionCallback =
+      std::function<size_t(const SMemoryReport &p_Report, size_t p_szOver)>;
+
+  // 0 disables the budget
+  void SetBudget(size_t p_szBytes) { m_szBudget = p_szBytes; }
+  size_t GetBudget() const { return m_szBudget; }
+
+  uint32_t AddEvictionCallback(EvictionCallback p_Callback);
+  void RemoveEvictionCallback(uint32_t p_uiCallbackID);
+
+  // Returns true when the report fits the budget
+  bool Evaluate(const SMemoryReport &p_Report);
+
+  uint64_t GetOverBudgetFrames() const { return m_uiOverBudgetFrames; }
+
+private:
+  struct SCallbackEntry {
+    uint32_t id = 0;
+    EvictionCallback callback;
+  };
+
+  std::vector<SCallbackEntry> m_Callbacks;
+  uint32_t m_uiNextCallbackID = 0;
+
+  size_t m_szBudget = 0;
+  uint64_t m_uiOverBudgetFrames = 0;
+  bool m_bWasOverBudget = false;
+};
+
+} // namespace eHazGraphics
+
+#endif
@@ -2,6 +2,7 @@
 #define EHAZ_MESH_HPP
 
 #include "DataStructs.hpp"
+#include <boost/serialization/version.hpp>
 #include <vector>
 
 namespace eHazGraphics {
@@ -10,6 +11,8 @@ class Mesh {
 private:
   // add variables for used textures and transforms.
   MeshData data{};
+  std::vector<SMeshLOD> lods; // lods[0] is LOD 1, data is LOD 0
+  std::vector<SMeshlet> meshlets; // clusters of LOD 0, empty when not built
   ShaderComboID shaderID{};
   MeshID ID;
   GLuint instances = 1;
@@ -37,9 +40,42 @@ public:
   void SetResidencyStatus(bool value) { GPUresident = value; }
 
   const MeshData &GetMeshData() const { return data; }
+  MeshData &GetMeshData() { return data; }
 
   const GLuint &GetInstanceCount() const { return instances; }
 
+  // Levels of detail, 0 is the full mesh
+  uint32_t GetLODCount() const { return 1 + lods.size(); }
+
+  const MeshData &GetLODData(uint32_t lod) const {
+    return lod == 0 ? data : lods[lod - 1].data;
+  }
+
+  float GetLODError(uint32_t lod) const {
+    return lod == 0 ? 0.0f : lods[lod - 1].error;
+  }
+
+  const std::vector<SMeshLOD> &GetLODs() const { return lods; }
+
+  void SetLODs(std::vector<SMeshLOD> newLods) { lods = std::move(newLods); }
+
+  const std::vector<SMeshlet> &GetMeshlets() const { return meshlets; }
+
+  void SetMeshlets(std::vector<SMeshlet> newMeshlets) {
+    meshlets = std::move(newMeshlets);
+  }
+
+  // Queues every level for a batched InsertNewStaticData(), LOD 0 first
+  void AppendLODUploads(std::vector<SStaticMeshUpload> &uploads) const {
+    for (uint32_t lod = 0; lod < GetLODCount(); lod++) {
+      const MeshData &lodData = GetLODData(lod);
+      uploads.push_back({lodData.vertices.data(),
+                         lodData.vertices.size() * sizeof(Vertex),
+                         lodData.indecies.data(),
+                         lodData.indecies.size() * sizeof(GLuint)});
+    }
+  }
+
   void SetShader(ShaderComboID &shader) { shaderID = shader; }
 
   void setRelativeMatrix(const glm::mat4 &mat) { relativeMatrix = mat; }
@@ -61,9 +97,18 @@ public:
     ar & data;
     ar & shaderID;
     ar & relativeMatrix;
+
+    if (version > 0)
+      ar & lods;
+    if (version > 1)
+      ar & meshlets;
   }
 };
 
 } // namespace eHazGraphics
 
+// version 1 added the LOD chain, version 2 the meshlets, older packages load
+// without them
+BOOST_CLASS_VERSION(eHazGraphics::Mesh, 2)
+
 #endif
@@ -4,6 +4,9 @@
 #include "BitFlags.hpp"
 #include "BufferManager.hpp"
 #include "DataStructs.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshletBuilder.hpp"
+#include "MeshSimplifier.hpp"
 #include "Model.hpp"
 
 #include "ModelPackage.hpp"
@@ -16,6 +19,7 @@
 #include <cstddef>
 #include <memory>
 #include <mutex>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -32,18 +36,21 @@ public:
 
       bufferManager->InvalidateStaticRange(meshLoc);
     }
+    for (auto &[id, locations] : lodLocations) {
+      for (auto &location : locations) {
+        bufferManager->InvalidateStaticRange(location);
+      }
+    }
     for (auto &[id, model] : loadedModels) {
       model->ClearInstances();
     }
-    // call the function from buffer manager to clear the ranges
-
-   // for (auto&[ID, l_meshTransform] : meshTransformRanges) {
-   //     bufferManager->RemoveRange(l_meshTransform);
-   // }
+    for (auto &[id, transform] : meshTransforms) {
+      bufferManager->GetStaticMatrixPool().Remove(id);
+    }
 
     meshTransforms.clear();
-    meshTransformRanges.clear();
     meshLocations.clear();
+    lodLocations.clear();
     meshes.clear();
 
     submittedModels.clear();
@@ -70,6 +77,24 @@ public:
     return meshTransforms[mesh];
   }
 
+  // Only rewrites the pooled GPU matrix when it actually changed
+  void SetMeshTransform(MeshID mesh, const glm::mat4 &transform) {
+    meshTransforms[mesh] = transform;
+    bufferManager->GetStaticMatrixPool().SetMatrix(mesh, transform);
+  }
+
+  // Element index of the mesh's relative matrix in
+  // BUFFER_STATIC_MATRIX_DATA, uploaded on first use if it was not pooled at
+  // load time
+  uint32_t GetMeshTransformID(const MeshID &mesh) {
+    CStaticMatrixPool &pool = bufferManager->GetStaticMatrixPool();
+
+    if (auto index = pool.GetMatrixID(mesh))
+      return *index;
+
+    return pool.SetMatrix(mesh, meshTransforms[mesh]);
+  }
+
   void SetModelShader(std::shared_ptr<Model> model, ShaderComboID &shader);
 
   void SetMeshResidency(MeshID mesh, bool value) {
@@ -86,23 +111,24 @@ public:
     return meshLocations[mesh];
   }
 
-  void SaveMeshLocation(const MeshID &mesh, const VertexIndexInfoPair &range) {
-    meshLocations.try_emplace(mesh, range);
-  }
-
-  bool ContainsTransformRange(const MeshID &mesh) {
-
-    return meshTransformRanges.contains(mesh);
+  // Ranges of the reduced levels, uploaded right after the mesh itself
+  void AddMeshLODLocations(const MeshID &mesh,
+                           std::vector<VertexIndexInfoPair> locations) {
+    lodLocations.try_emplace(mesh, std::move(locations));
   }
 
-  void AddTransformRange(const MeshID &mesh, const SBufferRange &range) {
+  // LOD 0 is the mesh itself, levels past the last one use the last one
+  const VertexIndexInfoPair &GetMeshLocation(const MeshID &mesh,
+                                             uint32_t lod) {
+    auto it = lodLocations.find(mesh);
+    if (lod == 0 || it == lodLocations.end() || it->second.empty())
+      return meshLocations[mesh];
 
-    meshTransformRanges.try_emplace(mesh, range);
+    return it->second[std::min<size_t>(lod, it->second.size()) - 1];
   }
 
-  const SBufferRange GetTransformBufferRange(const MeshID &mesh) {
-
-    return meshTransformRanges[mesh];
+  void SaveMeshLocation(const MeshID &mesh, const VertexIndexInfoPair &range) {
+    meshLocations.try_emplace(mesh, range);
   }
 
   void ClearSubmittedModelInstances() {
@@ -110,7 +136,6 @@ public:
       model->ClearInstances();
       
     }
-    meshTransformRanges.clear();
     submittedModels.clear();
   }
 
@@ -151,6 +176,34 @@ public:
   std::vector<ModelID>
   LoadHazModelList(std::vector<StaticModelPackage> &packages);
 
+  // Mesh optimization run on imported meshes and on .hazm export
+  void SetMeshOptimizeSettings(const SMeshOptimizeSettings &settings) {
+    meshOptimizeSettings = settings;
+  }
+  const SMeshOptimizeSettings &GetMeshOptimizeSettings() const {
+    return meshOptimizeSettings;
+  }
+
+  // LOD chain built for imported meshes, and on export for meshes without one
+  void SetLODSettings(const SMeshLODSettings &settings) {
+    lodSettings = settings;
+  }
+  const SMeshLODSettings &GetLODSettings() const { return lodSettings; }
+
+  // Cluster split of large meshes at import, and on export for meshes
+  // without one
+  void SetMeshletSettings(const SMeshletSettings &settings) {
+    meshletSettings = settings;
+  }
+  const SMeshletSettings &GetMeshletSettings() const {
+    return meshletSettings;
+  }
+
+  // Totals of the last LoadModel() or ExportHazModel() call
+  const SMeshOptimizeStats &GetLastOptimizeStats() const {
+    return lastOptimizeStats;
+  }
+
   void Destroy(); // TODO: IMPLEMENT
 
 private:
@@ -163,6 +216,9 @@ private:
 
   void ValidateLoadedFiles();
 
+  // uploads the missing meshes of every model in one batch
+  void ValidateLoadedFiles(std::span<const ModelID> models);
+
   std::vector<MeshID> processNode(aiNode *node, const aiScene *scene);
   Mesh processMesh(aiMesh *mesh, const aiScene *scene);
   /* vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type,
@@ -176,11 +232,16 @@ private:
   std::unordered_map<MeshID, Mesh> meshes;
   // std::unordered_map<std::string, MeshID> meshPaths;
   std::unordered_map<MeshID, glm::mat4> meshTransforms;
-  std::unordered_map<MeshID, SBufferRange> meshTransformRanges;
   std::unordered_map<MeshID, VertexIndexInfoPair> meshLocations;
+  std::unordered_map<MeshID, std::vector<VertexIndexInfoPair>> lodLocations;
 
   std::mutex mapMutex;
 
+  SMeshOptimizeSettings meshOptimizeSettings;
+  SMeshLODSettings lodSettings;
+  SMeshletSettings meshletSettings;
+  SMeshOptimizeStats lastOptimizeStats;
+
   BufferManager *bufferManager;
   Assimp::Importer importer;
 };
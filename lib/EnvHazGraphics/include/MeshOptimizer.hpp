@@ -0,0 +1,79 @@
+#ifndef EHAZ_GRAPHICS_MESH_OPTIMIZER_HPP
+#define EHAZ_GRAPHICS_MESH_OPTIMIZER_HPP
+
+#include "DataStructs.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace eHazGraphics {
+
+// Which stages OptimizeMesh() runs, in the order listed
+struct SMeshOptimizeSettings {
+  bool vertexCache = true; // triangle order for the post-transform cache
+  bool overdraw = true;    // cluster order, outward facing clusters first
+  bool vertexFetch = true; // vertices in first use order, unused ones dropped
+
+  uint32_t cacheSize = 16; // FIFO size the ACMR statistics simulate
+};
+
+// Before/after numbers of one or more optimized meshes. ACMR is transformed
+// vertices per triangle (0.5 best, 3 worst), ATVR transformed vertices per
+// vertex (1 best).
+struct SMeshOptimizeStats {
+  uint64_t meshes = 0;
+  uint64_t triangles = 0;
+  uint64_t verticesBefore = 0;
+  uint64_t verticesAfter = 0;
+  uint64_t cacheMissesBefore = 0;
+  uint64_t cacheMissesAfter = 0;
+
+  float GetACMRBefore() const { return Ratio(cacheMissesBefore, triangles); }
+  float GetACMRAfter() const { return Ratio(cacheMissesAfter, triangles); }
+  float GetATVRBefore() const {
+    return Ratio(cacheMissesBefore, verticesBefore);
+  }
+  float GetATVRAfter() const { return Ratio(cacheMissesAfter, verticesAfter); }
+
+  void Add(const SMeshOptimizeStats &p_Other);
+
+  // One SDL_Log line, p_sName says what the numbers belong to
+  void Log(const char *p_sName) const;
+
+private:
+  static float Ratio(uint64_t p_uiValue, uint64_t p_uiTotal) {
+    return p_uiTotal == 0 ? 0.0f
+                          : static_cast<float>(p_uiValue) /
+                                static_cast<float>(p_uiTotal);
+  }
+};
+
+// Reorders the triangles and vertices of an indexed triangle list in place,
+// what gets drawn stays the same
+SMeshOptimizeStats OptimizeMesh(MeshData &p_Mesh,
+                                const SMeshOptimizeSettings &p_Settings = {});
+
+// Fills p_Mesh.bounds from the vertices, left invalid for an empty mesh
+void ComputeMeshBounds(MeshData &p_Mesh);
+
+// Vertices a FIFO cache of p_uiCacheSize entries transforms for the list
+uint64_t SimulateVertexCache(const std::vector<GLuint> &p_Indices,
+                             size_t p_szVertexCount, uint32_t p_uiCacheSize);
+
+// Forsyth's linear-speed vertex cache optimization
+void OptimizeVertexCache(std::vector<GLuint> &p_Indices,
+                         size_t p_szVertexCount);
+
+// Splits the list where the cache restarts and sorts those clusters so the
+// ones pointing out of the mesh draw first and occlude the rest. Needs a
+// cache optimized list to find useful clusters.
+void OptimizeOverdraw(std::vector<GLuint> &p_Indices,
+                      const std::vector<Vertex> &p_Vertices,
+                      uint32_t p_uiCacheSize);
+
+// Renumbers vertices in the order the indices first use them
+void OptimizeVertexFetch(std::vector<Vertex> &p_Vertices,
+                         std::vector<GLuint> &p_Indices);
+
+} // namespace eHazGraphics
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef EHAZ_GRAPHICS_MESH_SIMPLIFIER_HPP
+#define EHAZ_GRAPHICS_MESH_SIMPLIFIER_HPP
+
+#include "DataStructs.hpp"
+#include "MeshOptimizer.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace eHazGraphics {
+
+// How GenerateMeshLODs() builds the chain after the full mesh
+struct SMeshLODSettings {
+  uint32_t maxLODs = 3;     // reduced levels, 0 turns generation off
+  float reduction = 0.5f;   // share of the previous level's triangles kept
+  float maxError = 0.05f;   // deviation limit relative to the mesh extent
+  size_t minTriangles = 32; // no level is built below this
+};
+
+// Quadric error edge collapse, returns a new index list into the same
+// vertices. Stops at p_szTargetIndexCount or once a collapse would move the
+// surface further than p_fTargetError (object space). Borders and attribute
+// seams are kept in place, so flat shaded meshes barely reduce.
+std::vector<GLuint> SimplifyMesh(const std::vector<Vertex> &p_Vertices,
+                                 const std::vector<GLuint> &p_Indices,
+                                 size_t p_szTargetIndexCount,
+                                 float p_fTargetError,
+                                 float *p_pResultError = nullptr);
+
+// Simplifies the full mesh down level by level, each level is optimized and
+// only keeps the vertices it uses. The chain ends early when a level would
+// not be noticeably smaller than the previous one.
+std::vector<SMeshLOD>
+GenerateMeshLODs(const MeshData &p_Mesh,
+                 const SMeshLODSettings &p_Settings = {},
+                 const SMeshOptimizeSettings &p_OptimizeSettings = {});
+
+} // namespace eHazGraphics
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef EHAZ_GRAPHICS_MESHLET_BUILDER_HPP
+#define EHAZ_GRAPHICS_MESHLET_BUILDER_HPP
+
+#include "DataStructs.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace eHazGraphics {
+
+// Which meshes BuildMeshlets() splits into clusters
+struct SMeshletSettings {
+  bool enabled = false;       // one command per cluster only pays off when
+                              // the clusters get culled
+  uint32_t maxTriangles = 128;
+  size_t minTriangles = 1024; // smaller meshes stay a single draw
+};
+
+// Regroups the triangles of p_Mesh into spatially compact clusters of at most
+// maxTriangles, each a contiguous run of the index list, and renumbers the
+// vertices in the new order. Returns nothing and leaves the mesh alone when
+// the settings skip it.
+std::vector<SMeshlet> BuildMeshlets(MeshData &p_Mesh,
+                                    const SMeshletSettings &p_Settings);
+
+// Bounding sphere and normal cone of the triangles in
+// [p_uiFirstIndex, p_uiFirstIndex + p_uiIndexCount)
+SMeshlet ComputeMeshletBounds(const MeshData &p_Mesh, uint32_t p_uiFirstIndex,
+                              uint32_t p_uiIndexCount);
+
+} // namespace eHazGraphics
+
+#endif
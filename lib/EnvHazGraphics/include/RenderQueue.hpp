@@ -3,10 +3,36 @@
 
 #include "BufferManager.hpp"
 #include "DataStructs.hpp"
+#include "FrustumCuller.hpp"
+#include "StagingArena.hpp"
+#include <array>
+#include <map>
+#include <span>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 namespace eHazGraphics {
 
+// Secondary sort criteria of a command, inside one shader the commands are
+// ordered by material, then front to back
+struct SDrawSortInfo {
+  uint32_t material = 0;
+  float depth = 0.0f; // distance to the camera, 0 when unknown
+};
+
+// Mergeable commands queued in a frame against the instanced commands they
+// were merged into
+struct SInstanceMergeStats {
+  uint32_t submitted = 0;
+  uint32_t merged = 0;
+
+  float GetCollapseRatio() const {
+    return merged == 0 ? 1.0f
+                       : static_cast<float>(submitted) /
+                             static_cast<float>(merged);
+  }
+};
+
 class RenderQueue {
 public:
   RenderQueue() = default;
@@ -16,12 +42,108 @@ public:
 
   int CreateRenderCommand(const VertexIndexInfoPair &offsetData, bool Static,
                           unsigned int InstanceDataID,
-                          unsigned int InstanceCount, ShaderComboID shaderID);
+                          unsigned int InstanceCount, ShaderComboID shaderID,
+                          const SDrawSortInfo &sortInfo = {});
+
+  // One command per listed meshlet of the mesh at offsetData, visible holds
+  // indices into meshlets. Returns how many commands were added.
+  int CreateClusterRenderCommands(const VertexIndexInfoPair &offsetData,
+                                  std::span<const SMeshlet> meshlets,
+                                  std::span<const uint32_t> visible,
+                                  bool Static, unsigned int InstanceDataID,
+                                  unsigned int InstanceCount,
+                                  ShaderComboID shaderID,
+                                  const SDrawSortInfo &sortInfo = {});
+
+  // One instance of the static mesh at offsetData whose InstanceData is only
+  // placed at submit time. The world space bounding sphere is frustum culled
+  // in batches first, the remaining commands sharing the mesh range and
+  // shader are then merged into one draw over a contiguous run of their
+  // instances.
+  void CreateMergeableRenderCommand(const VertexIndexInfoPair &offsetData,
+                                    const InstanceData &instance,
+                                    ShaderComboID shaderID,
+                                    const glm::vec3 &boundsCenter,
+                                    float boundsRadius,
+                                    const SDrawSortInfo &sortInfo = {});
+
+  // Off keeps one command per mergeable submission, still placed at submit
+  void SetInstanceMerging(bool enabled) { instanceMerging = enabled; }
+
+  // As of the last SubmitRenderCommands()
+  const SInstanceMergeStats &GetMergeStats() const { return mergeStats; }
+
+  // Shared with the Renderer, which tests the commands it cannot defer;
+  // SubmitRenderCommands() ends its frame
+  CFrustumCuller &GetFrustumCuller() { return frustumCuller; }
+  const SCullStats &GetCullStats() const { return frustumCuller.GetStats(); }
+
+  // Only resolves the command, safe to call from worker threads recording into
+  // a CStagingArena as long as no static data is inserted meanwhile
+  DrawElementsIndirectCommand BuildRenderCommand(const VertexIndexInfoPair &offsetData,
+                                                 unsigned int InstanceDataID,
+                                                 unsigned int InstanceCount);
+
+  // Same with the allocations of offsetData already resolved, e.g. through
+  // BufferManager::GetAllocations()
+  DrawElementsIndirectCommand BuildRenderCommand(const VertexIndexInfoPair &offsetData,
+                                                 const SAllocation &vertexAllocation,
+                                                 const SAllocation &indexAllocation,
+                                                 unsigned int InstanceDataID,
+                                                 unsigned int InstanceCount);
 
-  // Sends the draw commands to the gpu and returns a sorted vector of
-  // shaderIDs, each corresponding to
+  // Persistent static commands stay queued across frames until removed. They
+  // are kept grouped by shader, so adding or removing one never sorts, and
+  // they are only rewritten into a ring slot of the draw command buffer after
+  // something changed. instance is a retained CInstanceRegistry instance,
+  // remove its commands before releasing it or erasing the mesh.
+  // boundingSphere is in the instance's model space, a negative radius is
+  // never culled by the GPU culling pass.
+  SRenderCommandHandle
+  AddStaticCommand(const VertexIndexInfoPair &offsetData,
+                   const SInstanceHandle &instance, unsigned int InstanceCount,
+                   ShaderComboID shaderID,
+                   const glm::vec4 &boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f,
+                                                               -1.0f));
+
+  void RemoveStaticCommand(const SRenderCommandHandle &handle);
+
+  bool IsStaticCommandValid(const SRenderCommandHandle &handle) const;
+
+  uint32_t GetStaticCommandCount() const { return persistentCount; }
+
+  void ClearPersistentCommands();
+
+  // What the GPU culling pass consumes, laid out like the persistent region:
+  // one bounding sphere and one (range, range start) per command. The
+  // version changes whenever they are rebuilt.
+  const std::vector<DrawElementsIndirectCommand> &
+  GetPersistentCommands() const {
+    return PersistentUpload;
+  }
+  const std::vector<glm::vec4> &GetPersistentBounds() const {
+    return PersistentBounds;
+  }
+  const std::vector<glm::uvec2> &GetPersistentCommandRanges() const {
+    return PersistentCommandRanges;
+  }
+  uint32_t GetPersistentRangeCount() const {
+    return static_cast<uint32_t>(PersistentRanges.size());
+  }
+  uint32_t GetPersistentVersion() const { return persistentVersion; }
+
+  // Appends the commands of a merged arena, rebasing their baseInstance.
+  // Their material comes from the arena's instances.
+  void AppendStagedCommands(const CStagingArena &arena, bool Static);
+
+  // Sorts the per frame commands by a packed 64-bit key (pass, shader,
+  // material, depth, mesh), sends them to the gpu after the persistent ones
+  // and returns one range per (pass, shader) run
   std::vector<DrawRange> SubmitRenderCommands();
 
+  // Where the last SubmitRenderCommands() put the sorted commands
+  const SBufferRange &GetCommandBufferLocation() const { return bufferLocation; }
+
   void ClearDynamicCommands();
 
   bool UpdateDynamicCommand(
@@ -33,16 +155,168 @@ public:
   void Destroy();
 
 private:
+  struct SQueuedCommand {
+    DrawElementsIndirectCommand command;
+    ShaderComboID shader;
+    SDrawSortInfo sortInfo;
+  };
+
+  using CommandList = std::vector<SQueuedCommand>;
+
+  // commands that draw the same mesh with the same shader
+  struct SMergeKey {
+    uint32_t type;
+    uint32_t count;
+    uint32_t firstIndex;
+    uint32_t baseVertex;
+    ShaderComboID shader;
+
+    bool operator==(const SMergeKey &other) const {
+      return type == other.type && count == other.count &&
+             firstIndex == other.firstIndex &&
+             baseVertex == other.baseVertex && shader == other.shader;
+    }
+  };
+
+  struct SMergeKeyHasher {
+    std::size_t operator()(const SMergeKey &key) const noexcept {
+      std::size_t hash = ShaderComboID::ShaderComboHasher()(key.shader);
+      for (uint32_t value :
+           {key.type, key.count, key.firstIndex, key.baseVertex}) {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+      }
+      return hash;
+    }
+  };
+
+  struct SMergeGroup {
+    SQueuedCommand queued;
+    uint32_t type = 0;
+    uint32_t firstInstance = 0; // into MergedInstances
+    uint32_t instanceCount = 0;
+    uint32_t filled = 0;
+  };
+
+  // world space bounding spheres of the mergeable commands
+  struct SSphereBatch {
+    std::vector<float> x, y, z, radius;
+
+    void clear() {
+      x.clear();
+      y.clear();
+      z.clear();
+      radius.clear();
+    }
+  };
+
+  struct SSortEntry {
+    uint64_t key;
+    uint32_t index; // into SortSources
+  };
+
+  // every list is split by IndexType, one glMultiDrawElementsIndirect only
+  // takes a single index type
+  static constexpr size_t INDEX_TYPE_COUNT = 2;
+  using IndexTypeLists = std::array<CommandList, INDEX_TYPE_COUNT>;
+
+  static size_t ListIndex(IndexType type) { return static_cast<size_t>(type); }
+
+  CommandList &GetCommandList(const VertexIndexInfoPair &ranges, bool isStatic);
+
+  struct SPersistentCommand {
+    VertexIndexInfoPair ranges;
+    SInstanceHandle instance;
+    unsigned int instanceCount = 1;
+    ShaderComboID shader;
+    glm::vec4 boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, -1.0f);
+    uint32_t bucketPosition = 0; // index inside its shader bucket
+    uint32_t generation = 0;
+    bool alive = false;
+  };
+
+  struct ShaderComboLess {
+    bool operator()(const ShaderComboID &a, const ShaderComboID &b) const {
+      if (a.vertex != b.vertex)
+        return a.vertex < b.vertex;
+      return a.fragment < b.fragment;
+    }
+  };
+
+  // persistent command indices per shader, iterating the map gives the draw
+  // order
+  using ShaderBuckets =
+      std::map<ShaderComboID, std::vector<uint32_t>, ShaderComboLess>;
+
+  static constexpr uint16_t SORT_SHADER_MASK = 0xFFFF;
+
+  // dense per shader index for the sort key, stable across frames
+  uint16_t GetShaderSortIndex(const ShaderComboID &shader);
+
+  // groups the mergeable commands, uploads their instances contiguously and
+  // resolves one command per group
+  void MergeInstancedCommands();
+
+  static void RadixSortEntries(std::vector<SSortEntry> &entries,
+                               std::vector<SSortEntry> &scratch);
+
+  // flattens the buckets into commands and ranges, only after a change
+  void RebuildPersistentCommands();
+
+  // writes the persistent commands into the write slot if it is stale,
+  // false when the region could not be reserved this frame
+  bool UploadPersistentCommands();
+
   BufferManager *bufferManager;
 
-  std::vector<std::pair<DrawElementsIndirectCommand, ShaderComboID>>
-      DynamicCommands;
+  IndexTypeLists DynamicCommands;
   SBufferRange bufferLocation = SBufferRange();
   int numCommands = 0;
   int previousNumCommands = 0;
 
-  std::vector<std::pair<DrawElementsIndirectCommand, ShaderComboID>>
-      StaticCommands;
+  IndexTypeLists StaticCommands;
+
+  // commands drawing from BUFFER_ANIMATED_MESH_DATA, kept apart since they
+  // bind a different VAO; cleared together with the static commands
+  IndexTypeLists AnimatedCommands;
+
+  // static geometry only, InstanceData parallel to the commands; cleared
+  // together with the static commands
+  IndexTypeLists MergeableCommands;
+  std::array<std::vector<InstanceData>, INDEX_TYPE_COUNT> MergeableInstances;
+  std::array<SSphereBatch, INDEX_TYPE_COUNT> MergeableSpheres;
+  std::array<std::vector<uint8_t>, INDEX_TYPE_COUNT> MergeableVisible;
+
+  CFrustumCuller frustumCuller;
+
+  std::unordered_map<SMergeKey, uint32_t, SMergeKeyHasher> MergeLookup;
+  std::vector<SMergeGroup> MergeGroups;
+  std::vector<uint32_t> MergeGroupOf; // per mergeable command, in list order
+  std::vector<InstanceData> MergedInstances;
+  bool instanceMerging = true;
+  SInstanceMergeStats mergeStats;
+
+  std::unordered_map<ShaderComboID, uint16_t, ShaderComboID::ShaderComboHasher>
+      ShaderSortIndices;
+  std::vector<const SQueuedCommand *> SortSources;
+  std::vector<SSortEntry> SortEntries;
+  std::vector<SSortEntry> SortScratch;
+
+  std::vector<SPersistentCommand> PersistentCommands;
+  std::vector<uint32_t> FreePersistentCommands;
+  std::array<ShaderBuckets, INDEX_TYPE_COUNT> PersistentBuckets;
+
+  std::vector<DrawElementsIndirectCommand> PersistentUpload;
+  std::vector<DrawRange> PersistentRanges;
+  std::vector<glm::vec4> PersistentBounds;
+  std::vector<glm::uvec2> PersistentCommandRanges;
+  // vertex and index range of every persistent command, resolved in one batch
+  std::vector<SBufferRange> PersistentLookupRanges;
+  std::vector<std::optional<SAllocation>> PersistentAllocations;
+  uint32_t persistentVersion = 0;
+  uint32_t staticLayoutVersion = 0; // of the buffer manager at the last build
+  uint32_t persistentCount = 0;
+  bool persistentChanged = false;
+  uint8_t persistentDirtySlots = 0; // one bit per ring slot still stale
 };
 
 } // namespace eHazGraphics
@@ -9,7 +9,9 @@
 #include <map>
 #include <memory>
 #include <platform.hpp>
+#include <span>
 #include <string>
+#include <unordered_map>
 #include <vector>
 // temp
 
@@ -18,10 +20,13 @@
 #include "BufferManager.hpp"
 #include "DataStructs.hpp"
 #include "FrameBuffers/FrameBuffer.hpp"
+#include "GPUCuller.hpp"
 #include "MaterialManager.hpp"
+#include "MemoryBudget.hpp"
 #include "MeshManager.hpp"
 #include "RenderQueue.hpp"
 #include "ShaderManager.hpp"
+#include "StagingArena.hpp"
 #include "Window.hpp"
 namespace eHazGraphics {
 // eHazGAPI
@@ -57,9 +62,76 @@ public:
   void SubmitStaticModel(std::shared_ptr<Model> &model, glm::mat4 position,
                          TypeFlags dataType); // require a an object/container
                                               // from which to unwrap everything
+
+  // Camera used to pick static mesh LODs and cull static meshes against the
+  // frustum, call before submitting. Without a view every mesh draws at full
+  // detail.
+  void SetView(const glm::mat4 &view, const glm::mat4 &projection);
+
+  // Frustum culling of submitted static meshes, on by default once a view is
+  // set. Skinned and persistent commands are never culled.
+  void SetFrustumCulling(bool enabled);
+  // Spheres tested in the last submitted frame
+  const SCullStats &GetCullStats() const;
+
+  // Persistent static commands are frustum culled by a compute pass and drawn
+  // with glMultiDrawElementsIndirectCount, no CPU work per frame. Needs frustum
+  // culling on and a view; false when the compute programme failed to build.
+  bool SetGPUCulling(bool enabled);
+
+  // Largest on screen deviation, in pixels, a reduced LOD may have
+  void SetLODPixelError(float pixels) { m_fLODPixelError = pixels; }
+
+  // Drops meshlets whose triangles all face away from the view, only valid
+  // while back faces are culled
+  void SetMeshletConeCulling(bool enabled) { m_bMeshletConeCulling = enabled; }
+
+  // Drops meshlets whose bounding spheres lie outside the frustum, needs
+  // frustum culling on. Either meshlet test draws LOD 0 per cluster.
+  void SetMeshletFrustumCulling(bool enabled) {
+    m_bMeshletFrustumCulling = enabled;
+  }
   void SubmitAnimatedModel(std::shared_ptr<AnimatedModel> &model,
                            glm::mat4 position);
 
+  // Retained instances: register once, move with SetRegisteredModelTransform
+  // and submit every frame without re-inserting InstanceData.
+  std::vector<SInstanceHandle>
+  RegisterStaticModel(std::shared_ptr<Model> &model, glm::mat4 position,
+                      TypeFlags dataType);
+  std::vector<SInstanceHandle>
+  RegisterAnimatedModel(std::shared_ptr<AnimatedModel> &model,
+                        glm::mat4 position);
+
+  void SetRegisteredModelTransform(const std::vector<SInstanceHandle> &handles,
+                                   const glm::mat4 &position);
+
+  void SubmitRegisteredStaticModel(std::shared_ptr<Model> &model,
+                                   const std::vector<SInstanceHandle> &handles,
+                                   TypeFlags dataType);
+  void
+  SubmitRegisteredAnimatedModel(std::shared_ptr<AnimatedModel> &model,
+                                const std::vector<SInstanceHandle> &handles);
+
+  void ReleaseRegisteredModel(std::vector<SInstanceHandle> &handles);
+
+  // Queues the registered model once as persistent static commands, drawn
+  // every frame until removed without resubmitting or resorting. Moving it
+  // only needs SetRegisteredModelTransform. Always full detail and whole
+  // meshes, the per frame submit paths do the LOD and meshlet selection.
+  std::vector<SRenderCommandHandle>
+  AddPersistentStaticModel(std::shared_ptr<Model> &model,
+                           const std::vector<SInstanceHandle> &handles,
+                           TypeFlags dataType);
+
+  // Call before ReleaseRegisteredModel on the same instances
+  void RemovePersistentStaticModel(std::vector<SRenderCommandHandle> &commands);
+
+  // Merges arenas recorded on worker threads into this frame's instance data
+  // and render queue. Call on the render thread once recording finished.
+  void SubmitStagingArenas(std::span<CStagingArena *const> arenas,
+                           bool isStatic = true);
+
   SBufferRange
   SubmitDynamicData(const void *data, size_t dataSize,
                     TypeFlags dataType); // same, require a container later/
@@ -113,6 +185,12 @@ public:
 
   void UpdateRenderer(float deltaTime);
 
+  // GPU memory of all buffers and textures as of the last RenderFrame
+  const SMemoryReport &GetMemoryReport() const { return m_MemoryReport; }
+
+  // Budget checked against the report at the end of every RenderFrame
+  CMemoryBudget &GetMemoryBudget() { return m_MemoryBudget; }
+
   // future
 
 #ifdef EHAZ_DEBUG_DRAWING
@@ -141,6 +219,52 @@ public:
   void Destroy();
 
 private:
+  VertexIndexInfoPair ResolveStaticMeshLocation(const MeshID &mesh,
+                                                TypeFlags dataType,
+                                                uint32_t lod = 0);
+  uint32_t SelectStaticLOD(const Mesh &mesh, const glm::mat4 &world) const;
+  void CullMeshlets(const Mesh &mesh, const glm::mat4 &world,
+                    std::vector<uint32_t> &visible) const;
+  // whether the mesh is drawn as culled meshlets instead of one command
+  bool UsesMeshletCommands(const Mesh &mesh, uint32_t lod) const;
+  // one command for the mesh, or one per visible meshlet
+  void CreateStaticMeshCommands(const VertexIndexInfoPair &range,
+                                const Mesh &mesh, uint32_t lod,
+                                const glm::mat4 &world,
+                                unsigned int instanceID, uint32_t materialID);
+  // false when the mesh's bounds lie outside the frustum
+  bool IsStaticMeshVisible(const Mesh &mesh, const glm::mat4 &world);
+  // material and camera distance the render queue orders commands by
+  SDrawSortInfo MakeSortInfo(uint32_t materialID, const glm::mat4 &world) const;
+  VertexIndexInfoPair ResolveAnimatedMeshLocation(const MeshID &mesh);
+  uint32_t ResolveStaticMatrixID(const MeshID &mesh);
+  // points the registered instances of mesh at its new pooled matrix
+  void RetargetRegisteredStaticMeshes(const MeshID &mesh, uint32_t matrixID);
+  InstanceData BuildAnimatedInstance(std::shared_ptr<AnimatedModel> &model,
+                                     const glm::mat4 &position);
+
+  void UpdateMemoryReport();
+
+  SMemoryReport m_MemoryReport;
+  CMemoryBudget m_MemoryBudget;
+
+  glm::vec3 m_ViewPosition = glm::vec3(0.0f);
+  float m_fLODProjectionScale = 0.0f;
+  float m_fLODPixelError = 1.0f;
+  bool m_bHasView = false;
+  bool m_bMeshletConeCulling = false;
+  bool m_bMeshletFrustumCulling = false;
+  std::vector<uint32_t> m_VisibleMeshlets;
+
+  // handles from RegisterStaticModel() per mesh, see
+  // RetargetRegisteredStaticMeshes()
+  std::unordered_map<MeshID, std::vector<SInstanceHandle>>
+      m_RegisteredStaticMeshes;
+
+  CGPUCuller m_GPUCuller;
+  bool m_bGPUCulling = false;
+  uint32_t m_uiGPUCullVersion = 0; // persistent commands the culler holds
+
   GLsync m_frameFence = nullptr;
   int vp_width, vp_height;
   FrameBuffer mainFBO;
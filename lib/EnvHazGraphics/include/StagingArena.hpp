@@ -0,0 +1,66 @@
+#ifndef EHAZ_GRAPHICS_STAGING_ARENA_HPP
+#define EHAZ_GRAPHICS_STAGING_ARENA_HPP
+
+#include "DataStructs.hpp"
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace eHazGraphics {
+
+// CPU side linear arena one worker thread records into while traversing its
+// part of the scene. Nothing in here touches shared state, so every thread can
+// own one. Instance indices are local to the arena until
+// BufferManager::MergeStagingArenas() gives the arena its base instance.
+class CStagingArena {
+public:
+  CStagingArena();
+
+  CStagingArena(size_t p_szInstanceReserve, size_t p_szCommandReserve);
+
+  // Returns the index of the instance inside this arena
+  uint32_t PushInstance(const InstanceData &p_Instance);
+
+  // p_Command.baseInstance is an index returned by PushInstance(),
+  // p_IndexType is the indexType of the range the command was built from
+  void PushDrawCommand(const DrawElementsIndirectCommand &p_Command,
+                       const ShaderComboID &p_Shader,
+                       IndexType p_IndexType = IndexType::UINT32);
+
+  // Keeps the capacity, call once per frame before recording
+  void Reset();
+
+  const std::vector<InstanceData> &GetInstances() const { return m_Instances; }
+
+  const std::vector<std::pair<DrawElementsIndirectCommand, ShaderComboID>> &
+  GetCommands(IndexType p_IndexType = IndexType::UINT32) const {
+    return m_Commands[static_cast<size_t>(p_IndexType)];
+  }
+
+  void SetBaseInstance(uint32_t p_uiBaseInstance) {
+    m_uiBaseInstance = p_uiBaseInstance;
+  }
+
+  // First element of this arena inside BUFFER_INSTANCE_DATA after the merge,
+  // INVALID_ALLOCATION before it
+  uint32_t GetBaseInstance() const { return m_uiBaseInstance; }
+
+  // Instance index inside BUFFER_INSTANCE_DATA, valid after the merge
+  uint32_t GetGPUIndex(uint32_t p_uiLocalIndex) const {
+    return m_uiBaseInstance + p_uiLocalIndex;
+  }
+
+private:
+  std::vector<InstanceData> m_Instances;
+  // one list per IndexType
+  std::array<std::vector<std::pair<DrawElementsIndirectCommand, ShaderComboID>>,
+             2>
+      m_Commands;
+
+  uint32_t m_uiBaseInstance = INVALID_ALLOCATION;
+};
+
+} // namespace eHazGraphics
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef EHAZ_GRAPHICS_STATIC_HEAP_HPP
+#define EHAZ_GRAPHICS_STATIC_HEAP_HPP
+
+#include "DataStructs.hpp"
+#include "glad/glad.h"
+#include <map>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace eHazGraphics {
+
+// General purpose static geometry storage used when BufferManager is not in
+// stack mode. Vertex and index data live in separate arenas, each with a best
+// fit free list that coalesces on release, so meshes can be loaded and
+// unloaded in any order without ever clearing the whole buffer.
+class CGLStaticHeap {
+public:
+  CGLStaticHeap();
+
+  CGLStaticHeap(size_t p_szInitialVertSize, size_t p_szInitialIndexSize,
+                uint32_t p_StaticHeapID);
+
+  VertexIndexInfoPair Insert(const Vertex *p_vertexData,
+                             size_t p_VertexDataSize,
+                             const GLuint *p_IndexData,
+                             size_t p_IndexDataSize);
+
+  VertexIndexInfoPair Insert(const MeshData &p_StaticData);
+
+  // Grows each arena at most once for the whole batch, then fills holes and
+  // the bump region like Insert()
+  std::vector<VertexIndexInfoPair>
+  Insert(std::span<const SStaticMeshUpload> p_Meshes);
+
+  // Frees the range right away, its handle goes stale
+  void InvalidateRange(const SBufferRange &p_range);
+
+  inline void InvalidateRange(const VertexIndexInfoPair &p_pair) {
+    InvalidateRange(p_pair.first);
+    InvalidateRange(p_pair.second);
+  }
+
+  bool isRangeValid(const SBufferRange &p_range) const;
+
+  std::optional<SAllocation> GetAllocation(const SBufferRange &p_range) const;
+
+  void BindBuffer();
+
+  // Binds both arenas as shader storage, for vertex pulling
+  void BindStorage(GLuint p_uiVertexBinding, GLuint p_uiIndexBinding) const;
+
+  GLuint GetIndexBuffer() const { return m_Index.buffer; }
+
+  void Clear();
+
+  uint32_t GetStaticHeapID() const { return m_StaticHeapID; }
+
+  bool IsCreated() const { return m_glVertexArray != 0; }
+
+  SBufferMemoryStats GetMemoryStats() const;
+
+  size_t GetVertexHighWaterMark() const { return m_Vertex.highWaterMark; }
+  size_t GetIndexHighWaterMark() const { return m_Index.highWaterMark; }
+
+  void Destroy();
+
+private:
+  struct SArena {
+    GLuint buffer = 0;
+    size_t bufferSize = 0;
+    size_t cursor = 0; // end of the highest allocation
+    size_t occupiedSize = 0;
+    size_t highWaterMark = 0;
+
+    std::vector<SAllocation> allocations;
+    std::vector<uint32_t> freeIDs;
+
+    // holes below the cursor, by offset for coalescing and by size for
+    // best fit
+    std::map<size_t, size_t> freeBlocks;
+    std::multimap<size_t, size_t> freeBlocksBySize;
+
+    std::optional<size_t> TakeFreeBlock(size_t p_szSize);
+    void Release(size_t p_szOffset, size_t p_szSize);
+    void InsertFreeBlock(size_t p_szOffset, size_t p_szSize);
+    void EraseFreeBlock(std::map<size_t, size_t>::iterator p_it);
+    void Reset();
+  };
+
+  SBufferRange Allocate(SArena &p_Arena, SlotType p_Slot, size_t p_szSize,
+                        size_t p_szElementSize, const void *p_pData);
+
+  void Grow(SArena &p_Arena, size_t p_szMinimumSize);
+
+  SArena &GetArena(SlotType p_Slot) {
+    return p_Slot == SlotType::VERTEX_SLOT ? m_Vertex : m_Index;
+  }
+  const SArena &GetArena(SlotType p_Slot) const {
+    return p_Slot == SlotType::VERTEX_SLOT ? m_Vertex : m_Index;
+  }
+
+  SArena m_Vertex;
+  SArena m_Index;
+
+  GLuint m_glVertexArray = 0;
+  uint32_t m_StaticHeapID = 0;
+};
+
+} // namespace eHazGraphics
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef EHAZ_GRAPHICS_STATIC_MATRIX_POOL_HPP
+#define EHAZ_GRAPHICS_STATIC_MATRIX_POOL_HPP
+
+#include "DataStructs.hpp"
+#include "DynamicBuffer.hpp"
+#include <cstdint>
+#include <functional>
+#include <glm/glm.hpp>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace eHazGraphics {
+
+// Relative mesh matrices kept in the persistent region of the static matrix
+// CDynamicBuffer, one stable element per MeshID. A matrix is uploaded once
+// when its mesh is validated; later changes only mark the entry dirty and the
+// dirty entries are written as coalesced ranges by one Flush() per frame.
+class CStaticMatrixPool {
+public:
+  CStaticMatrixPool();
+
+  CStaticMatrixPool(CDynamicBuffer *p_pMatrixBuffer,
+                    uint32_t p_uiInitialCapacity);
+
+  // Adds the mesh or, if it is already pooled and the matrix differs, marks
+  // its entry dirty. Returns the element index of the matrix.
+  uint32_t SetMatrix(const MeshID &p_Mesh, const glm::mat4 &p_Matrix);
+
+  void Remove(const MeshID &p_Mesh);
+
+  // Called when SetMatrix() hands a mesh a new index, e.g. when it is pooled
+  // again after Remove(), so holders of the old index can be retargeted
+  using IndexListener = std::function<void(const MeshID &, uint32_t)>;
+  void AddIndexListener(IndexListener p_Listener) {
+    m_IndexListeners.push_back(std::move(p_Listener));
+  }
+
+  bool Contains(const MeshID &p_Mesh) const {
+    return m_Indices.contains(p_Mesh);
+  }
+
+  std::optional<uint32_t> GetMatrixID(const MeshID &p_Mesh) const;
+
+  // Grows the reserved region if entries were added past it, call right
+  // after the matrix buffer moved to a new write slot.
+  void Reserve();
+
+  // Writes every entry still stale in the write slot, call once per frame
+  // before the buffer is fenced.
+  void Flush();
+
+  void Clear();
+
+  uint32_t GetLiveCount() const {
+    return static_cast<uint32_t>(m_Indices.size());
+  }
+  uint32_t GetDirtyCount() const {
+    return static_cast<uint32_t>(m_DirtyIndices.size());
+  }
+  uint32_t GetCapacity() const { return m_uiCapacity; }
+
+  // Ranges written by the last Flush(), i.e. how well dirty entries coalesced
+  uint32_t GetLastFlushRangeCount() const { return m_uiLastFlushRanges; }
+
+private:
+  void MarkDirty(uint32_t p_uiIndex);
+  bool GrowTo(uint32_t p_uiCount);
+  uint8_t GetWriteSlotBit() const;
+
+  CDynamicBuffer *m_pMatrixBuffer = nullptr;
+
+  std::unordered_map<MeshID, uint32_t> m_Indices;
+  std::vector<glm::mat4> m_Matrices;
+  std::vector<uint8_t> m_DirtySlots; // one bit per ring slot still stale
+
+  std::vector<uint32_t> m_FreeIndices;
+  std::vector<uint32_t> m_DirtyIndices;
+  std::vector<IndexListener> m_IndexListeners;
+
+  uint32_t m_uiCapacity = 0;
+  uint32_t m_uiLastFlushRanges = 0;
+  uint8_t m_uiAllSlotsMask = 0;
+};
+
+} // namespace eHazGraphics
+
+#endif
@@ -5,15 +5,38 @@
 #include "glad/glad.h"
 #include <optional>
 #include <platform.hpp>
+#include <span>
 #include <vector>
 namespace eHazGraphics {
 
+// Published when a compaction pass of a CGLStaticStack finishes. Dead
+// allocations are dropped, so every handle of the old generation has to be
+// patched through Apply() before it is used again.
+struct SStaticRemapTable {
+  uint32_t bufferID = 0;
+  uint32_t oldGeneration = 0;
+  uint32_t newGeneration = 0;
+  std::vector<uint32_t> newAllocationIDs; // INVALID_ALLOCATION when dropped
+
+  // Returns false when the range belongs to another stack, another
+  // generation, or to an allocation that no longer exists
+  bool Apply(SBufferRange &p_range) const;
+
+  bool Apply(VertexIndexInfoPair &p_pair) const {
+    bool l_bVertex = Apply(p_pair.first);
+    bool l_bIndex = Apply(p_pair.second);
+    return l_bVertex && l_bIndex;
+  }
+};
+
 class CGLStaticStack {
 public:
   CGLStaticStack();
 
   CGLStaticStack(size_t p_szInitialVertSize, size_t p_szInitialIndexSize,
-                 uint32_t p_StaticStackID);
+                 uint32_t p_StaticStackID,
+                 VertexFormat p_Format = VertexFormat::FULL,
+                 TypeFlags p_DataType = TypeFlags::BUFFER_STATIC_MESH_DATA);
 
   VertexIndexInfoPair push_back(const Vertex *p_vertexData,
                                 size_t p_VertexDataSize,
@@ -22,6 +45,11 @@ public:
 
   VertexIndexInfoPair push_back(const MeshData &p_StaticData);
 
+  // Uploads every mesh with one resize at most and a single copy per buffer,
+  // the pairs come back in the order of p_Meshes
+  std::vector<VertexIndexInfoPair>
+  push_back(std::span<const SStaticMeshUpload> p_Meshes);
+
   void Clear();
 
   bool isRangeValid(const SBufferRange &p_range) const;
@@ -42,8 +70,59 @@ public:
 
   void BindBuffer();
 
+  // Binds the vertex and index buffers as shader storage, for vertex pulling
+  void BindStorage(GLuint p_uiVertexBinding, GLuint p_uiIndexBinding) const;
+
+  GLuint GetIndexBuffer() const { return m_glIndexBuffer; }
+
+  VertexFormat GetVertexFormat() const { return m_VertexFormat; }
+
+  // On by default, only affects meshes pushed afterwards
+  void SetIndexNarrowing(bool p_bValue) { m_bNarrowIndices = p_bValue; }
+
+  // Bytes per vertex as stored, baseVertex is the vertex offset divided by it
+  size_t GetVertexStride() const { return GetVertexStride(m_VertexFormat); }
+
+  static size_t GetVertexStride(VertexFormat p_Format) {
+    return p_Format == VertexFormat::PACKED ? sizeof(PackedVertex)
+                                            : sizeof(Vertex);
+  }
+
+  // Vertex layout shared by every static geometry container
+  static void ConfigureVertexArray(GLuint p_glVertexArray,
+                                   GLuint p_glVertexBuffer,
+                                   GLuint p_glIndexBuffer,
+                                   VertexFormat p_Format = VertexFormat::FULL);
+
   uint32_t GetStaticStackID() const { return m_StaticStackID; }
 
+  // Largest cursor positions reached since construction
+  size_t GetVertexHighWaterMark() const { return m_szVertexHighWaterMark; }
+  size_t GetIndexHighWaterMark() const { return m_szIndexHighWaterMark; }
+
+  // Vertex and index buffers together, dead allocations below the top of
+  // the stack count as wasted
+  SBufferMemoryStats GetMemoryStats() const;
+
+  size_t GetDeadBytes() const { return m_szVertexDeadSize + m_szIndexDeadSize; }
+  size_t GetUsedBytes() const { return m_szVertexCursor + m_szIndexCursor; }
+
+  // Incremental compaction: live allocations are moved down over the holes
+  // left by InvalidateRange(), at most p_szMaxBytes per StepCompaction().
+  // Handles stay valid while it runs, moved allocations only change offset.
+  void BeginCompaction();
+  bool IsCompacting() const { return m_bCompacting; }
+
+  // Returns true on the step that finished the pass, GetRemapTable() then
+  // holds the handle remap of the new generation
+  bool StepCompaction(size_t p_szMaxBytes);
+
+  const SStaticRemapTable &GetRemapTable() const { return m_RemapTable; }
+
+  // Bumped by every StepCompaction() that moved bytes, offsets read from
+  // allocations before the bump are out of date
+  uint32_t GetLayoutVersion() const { return m_uiLayoutVersion; }
+
   void pop_back();
 
   void Destroy();
@@ -54,6 +133,18 @@ private:
 
   void SetVertexAttribPointers();
 
+  // Records the next allocation pair at the cursors, no upload
+  VertexIndexInfoPair PushAllocation(size_t p_szVertexBytes,
+                                     size_t p_szIndexBytes,
+                                     IndexType p_IndexType);
+
+  IndexType ChooseIndexType(const GLuint *p_IndexData,
+                            size_t p_szIndexCount) const;
+
+  void MoveRange(GLuint p_glBuffer, size_t p_szSrc, size_t p_szDst,
+                 size_t p_szSize);
+  void FinishCompaction();
+
   std::vector<SAllocation> m_VertexAllocations;
   std::vector<SAllocation> m_IndexAllcoations;
 
@@ -64,6 +155,18 @@ private:
   GLuint m_glIndexBuffer = 0;
   uint32_t m_StaticStackID = 0;
 
+  VertexFormat m_VertexFormat = VertexFormat::FULL;
+  TypeFlags m_DataType = TypeFlags::BUFFER_STATIC_MESH_DATA; // of its ranges
+  std::vector<PackedVertex> m_PackedVertices; // conversion scratch
+
+  // meshes whose indices fit in 16 bits are stored as GL_UNSIGNED_SHORT
+  bool m_bNarrowIndices = true;
+  std::vector<GLushort> m_NarrowIndices; // conversion scratch
+
+  // batched uploads, released once the batch is copied
+  std::vector<unsigned char> m_VertexStaging;
+  std::vector<unsigned char> m_IndexStaging;
+
   size_t m_szVertexBufferSize = 0; // full size of current buffer
   size_t m_szIndexBufferSize = 0;
 
@@ -72,6 +175,24 @@ private:
 
   size_t m_szVertexCursor = 0; // from where to start writting
   size_t m_szIndexCursor = 0;
+
+  size_t m_szVertexHighWaterMark = 0;
+  size_t m_szIndexHighWaterMark = 0;
+
+  // invalidated bytes still below the cursors
+  size_t m_szVertexDeadSize = 0;
+  size_t m_szIndexDeadSize = 0;
+
+  static constexpr size_t COMPACTION_CHUNK_SIZE = 1024UL * 1024UL;
+
+  bool m_bCompacting = false;
+  uint32_t m_uiCompactionCursor = 0; // next allocation ID to move
+  size_t m_szCompactVertexDst = 0;
+  size_t m_szCompactIndexDst = 0;
+  GLuint m_glScratchBuffer = 0; // bounces moves whose ranges overlap
+  uint32_t m_uiLayoutVersion = 0;
+
+  SStaticRemapTable m_RemapTable;
 };
 
 } // namespace eHazGraphics
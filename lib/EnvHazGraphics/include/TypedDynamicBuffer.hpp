@@ -0,0 +1,113 @@
+#ifndef EHAZ_GRAPHICS_TYPED_DYNAMIC_BUFFER_HPP
+#define EHAZ_GRAPHICS_TYPED_DYNAMIC_BUFFER_HPP
+
+#include "BitFlags.hpp"
+#include "DataStructs.hpp"
+#include "DynamicBuffer.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <type_traits>
+
+namespace eHazGraphics {
+
+// Element type and std430 base alignment of each dynamic buffer. Buffers
+// without a specialization (lights, particles) stay untyped.
+template <TypeFlags Flag> struct SBufferElement;
+
+template <> struct SBufferElement<TypeFlags::BUFFER_INSTANCE_DATA> {
+  using type = InstanceData;
+  static constexpr size_t std430Alignment = 16; // mat4 member
+};
+
+template <> struct SBufferElement<TypeFlags::BUFFER_DRAW_CALL_DATA> {
+  using type = DrawElementsIndirectCommand;
+  static constexpr size_t std430Alignment = 4;
+};
+
+template <> struct SBufferElement<TypeFlags::BUFFER_ANIMATION_DATA> {
+  using type = glm::mat4;
+  static constexpr size_t std430Alignment = 16;
+};
+
+template <> struct SBufferElement<TypeFlags::BUFFER_STATIC_MATRIX_DATA> {
+  using type = glm::mat4;
+  static constexpr size_t std430Alignment = 16;
+};
+
+template <> struct SBufferElement<TypeFlags::BUFFER_CAMERA_DATA> {
+  using type = glm::mat4;
+  static constexpr size_t std430Alignment = 16;
+};
+
+template <> struct SBufferElement<TypeFlags::BUFFER_TEXTURE_DATA> {
+  using type = GLuint64;
+  static constexpr size_t std430Alignment = 8;
+};
+
+// Non owning view over a CDynamicBuffer that only accepts the element type
+// registered for Flag. Sizes and counts are compile time constants, so inserts
+// skip the TypeFlags switch of CDynamicBuffer::InsertNewData().
+template <typename T, TypeFlags Flag> class CTypedDynamicBuffer {
+public:
+  static_assert(std::is_same_v<T, typename SBufferElement<Flag>::type>,
+                "element type does not match the TypeFlags of the buffer");
+  static_assert(std::is_trivially_copyable_v<T>,
+                "dynamic buffer elements are memcpy'd into mapped memory");
+
+  static constexpr size_t ElementSize = sizeof(T);
+  static constexpr size_t Alignment = alignof(T);
+  static constexpr size_t Std430Stride =
+      (sizeof(T) + SBufferElement<Flag>::std430Alignment - 1) /
+      SBufferElement<Flag>::std430Alignment *
+      SBufferElement<Flag>::std430Alignment;
+
+  static_assert(Std430Stride == ElementSize,
+                "C++ layout does not match the std430 array stride");
+
+  explicit CTypedDynamicBuffer(CDynamicBuffer *p_pBuffer)
+      : m_pBuffer(p_pBuffer) {}
+
+  SBufferRange Insert(std::span<const T> p_Elements) {
+
+    const size_t l_szSize = p_Elements.size_bytes();
+
+    SBufferRange l_Range = m_pBuffer->ReserveElements(
+        l_szSize, static_cast<uint32_t>(p_Elements.size()), Flag);
+
+    m_pBuffer->WriteRange(GetOffset(l_Range), p_Elements.data(), l_szSize);
+
+    return l_Range;
+  }
+
+  SBufferRange Insert(const T &p_Element) {
+    return Insert(std::span<const T>(&p_Element, 1));
+  }
+
+  void Update(SBufferRange &p_Range, std::span<const T> p_Elements) {
+    m_pBuffer->UpdateRange(&p_Range, p_Elements.data(),
+                           p_Elements.size_bytes());
+  }
+
+  // First element of the range as an index into the SSBO array
+  uint32_t GetElementIndex(const SBufferRange &p_Range) {
+    return static_cast<uint32_t>(GetOffset(p_Range) / Std430Stride);
+  }
+
+  CDynamicBuffer *GetBuffer() const { return m_pBuffer; }
+
+private:
+  size_t GetOffset(const SBufferRange &p_Range) {
+    return m_pBuffer->GetAllocation(p_Range.handle.allocationID)->offset;
+  }
+
+  CDynamicBuffer *m_pBuffer = nullptr;
+};
+
+template <TypeFlags Flag>
+using TypedBufferFor =
+    CTypedDynamicBuffer<typename SBufferElement<Flag>::type, Flag>;
+
+} // namespace eHazGraphics
+
+#endif
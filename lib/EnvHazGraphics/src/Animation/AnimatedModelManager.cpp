@@ -40,6 +40,13 @@ namespace eHazGraphics {
  */
 void AnimatedModelManager::Initialize(BufferManager *bufferManager) {
   this->bufferManager = bufferManager;
+
+  bufferManager->AddStaticRemapListener(
+      [this](const SStaticRemapTable &remap) {
+        for (auto &[id, location] : meshLocations) {
+          remap.Apply(location);
+        }
+      });
 }
 void AnimatedModelManager::AddMeshLocation(const MeshID &mesh,
                                            VertexIndexInfoPair &location) {
@@ -215,7 +222,9 @@ AnimatedModelManager::LoadAnimatedModel(std::string path) {
 
   BuildBaseSkeleton();
   SetParentHierarchy(scene->mRootNode);
+  lastOptimizeStats = SMeshOptimizeStats();
   r_meshes = processNode(scene->mRootNode);
+  lastOptimizeStats.Log(path.c_str());
 
   SetParentHierarchy(scene->mRootNode);
 
@@ -598,7 +607,13 @@ Mesh AnimatedModelManager::processMesh(aiMesh *mesh) {
         vertex.boneWeights[i] /= sum;
     }
   }
-  Mesh finalMesh = Mesh({vertices, indices}, ShaderComboID());
+  // after the weights are fixed up, the reorder carries them along
+  MeshData data{vertices, indices};
+  lastOptimizeStats.Add(OptimizeMesh(data, meshOptimizeSettings));
+  // bind pose bounds, the animation can move past them
+  ComputeMeshBounds(data);
+
+  Mesh finalMesh = Mesh(data, ShaderComboID());
 
   return finalMesh;
 }
@@ -642,8 +657,8 @@ void AnimatedModelManager::UploadBonesToGPU(
   // If we don't have a valid allocation yet → allocate
   if (range.handle.allocationID == INVALID_ALLOCATION) {
 
-    range = bufferManager->InsertNewDynamicData(
-        finalMatrices.data(), byteSize, TypeFlags::BUFFER_ANIMATION_DATA);
+    range = bufferManager->GetTypedBuffer<TypeFlags::BUFFER_ANIMATION_DATA>()
+                .Insert(finalMatrices);
 
   } else {
     // Otherwise, update existing allocation
@@ -9,6 +9,7 @@
 #include "Utils/Boost_GLM_Serialization.hpp"
 
 #include <SDL3/SDL_log.h>
+#include <algorithm>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/detail/iserializer.hpp>
@@ -103,6 +104,24 @@ void MeshManager::ExportHazModel(std::string exportPath, ModelID modelID) {
     }
   }
 
+  // packages loaded from older files may not be optimized yet, the copies
+  // are written optimized while the resident meshes keep their ranges
+  lastOptimizeStats = SMeshOptimizeStats();
+  for (Mesh &mesh : modelMeshes) {
+    lastOptimizeStats.Add(
+        OptimizeMesh(mesh.GetMeshData(), meshOptimizeSettings));
+    ComputeMeshBounds(mesh.GetMeshData());
+
+    if (mesh.GetLODs().empty()) {
+      mesh.SetLODs(GenerateMeshLODs(mesh.GetMeshData(), lodSettings,
+                                    meshOptimizeSettings));
+    }
+
+    // the optimization above reordered the indices, old clusters are stale
+    mesh.SetMeshlets(BuildMeshlets(mesh.GetMeshData(), meshletSettings));
+  }
+  lastOptimizeStats.Log(exportPath.c_str());
+
   // Build package
   StaticModelPackage pkg;
   pkg.model = model;
@@ -142,9 +161,7 @@ MeshManager::LoadHazModelList(std::vector<std::string> paths) {
 
   auto ids = LoadHazModelListLimited(paths);
 
-  for (auto &id : ids) {
-    ValidateLoadedFile(id);
-  }
+  ValidateLoadedFiles(ids);
 
   return ids;
 }
@@ -164,50 +181,84 @@ MeshManager::LoadHazModelList(std::vector<StaticModelPackage> &packages) {
     loadedModels[pkg.model.GetID()] = std::make_shared<Model>(pkg.model);
   }
 
-  for (auto &id : models) {
-    ValidateLoadedFile(id);
-  }
+  ValidateLoadedFiles(models);
 
   return models;
 }
 
 void MeshManager::ValidateLoadedFile(ModelID model) {
+  ValidateLoadedFiles(std::span<const ModelID>(&model, 1));
+}
 
-  auto meshIDs = loadedModels[model]->GetMeshIDs();
+void MeshManager::ValidateLoadedFiles(std::span<const ModelID> models) {
 
-  for (auto &meshID : meshIDs) {
+  std::vector<MeshID> l_PendingMeshes;
+  std::vector<SStaticMeshUpload> l_Uploads;
 
-    Mesh &mesh = meshes[meshID];
+  for (const ModelID &model : models) {
 
-    if (!meshTransforms.contains(meshID)) {
-      glm::mat4 relMat = mesh.GetRelativeMatrix();
-      meshTransforms.emplace(meshID, relMat);
+    auto meshIDs = loadedModels[model]->GetMeshIDs();
 
-      SBufferRange relMatRange = bufferManager->InsertNewDynamicData(
-          &relMat, sizeof(relMat), TypeFlags::BUFFER_STATIC_MATRIX_DATA);
+    for (auto &meshID : meshIDs) {
 
-      meshTransformRanges.emplace(meshID, relMatRange);
-    }
+      Mesh &mesh = meshes[meshID];
 
-    if (!meshLocations.contains(meshID)) {
+      // packages written before the bounds were stored
+      if (!mesh.GetMeshData().bounds.IsValid()) {
+        ComputeMeshBounds(mesh.GetMeshData());
+      }
 
-      auto l_vertex = mesh.GetVertexData();
-      auto l_index = mesh.GetIndexData();
-      VertexIndexInfoPair l_viipLocation = bufferManager->InsertNewStaticData(
-          l_vertex.first, l_vertex.second, l_index.first, l_index.second,
-          TypeFlags::BUFFER_STATIC_MESH_DATA);
+      if (!meshTransforms.contains(meshID)) {
+        glm::mat4 relMat = mesh.GetRelativeMatrix();
+        meshTransforms.emplace(meshID, relMat);
+
+        // uploaded once, the pool keeps it across frames
+        bufferManager->GetStaticMatrixPool().SetMatrix(meshID, relMat);
+      }
+
+      // a mesh shared between models is only queued once
+      if (!meshLocations.contains(meshID) &&
+          std::find(l_PendingMeshes.begin(), l_PendingMeshes.end(), meshID) ==
+              l_PendingMeshes.end()) {
 
-      meshLocations.emplace(meshID, l_viipLocation);
+        mesh.AppendLODUploads(l_Uploads);
+        l_PendingMeshes.push_back(meshID);
+      }
     }
   }
+
+  if (l_Uploads.empty())
+    return;
+
+  std::vector<VertexIndexInfoPair> l_Locations =
+      bufferManager->InsertNewStaticData(l_Uploads,
+                                         TypeFlags::BUFFER_STATIC_MESH_DATA);
+
+  // every mesh took one location per level, LOD 0 first
+  auto l_itLocation = l_Locations.begin();
+  for (const MeshID &meshID : l_PendingMeshes) {
+    Mesh &mesh = meshes[meshID];
+    meshLocations.emplace(meshID, *l_itLocation);
+
+    std::vector<VertexIndexInfoPair> l_LODLocations(
+        l_itLocation + 1, l_itLocation + mesh.GetLODCount());
+    AddMeshLODLocations(meshID, std::move(l_LODLocations));
+
+    // the renderer would upload it a second time otherwise
+    mesh.SetResidencyStatus(true);
+    l_itLocation += mesh.GetLODCount();
+  }
 }
 
 void MeshManager::ValidateLoadedFiles() {
 
+  std::vector<ModelID> l_Models;
+  l_Models.reserve(loadedModels.size());
   for (auto &[modelID, model] : loadedModels) {
-
-    ValidateLoadedFile(modelID);
+    l_Models.push_back(modelID);
   }
+
+  ValidateLoadedFiles(l_Models);
 }
 
 /*
@@ -243,6 +294,14 @@ void AnimatedModelManager::ExportAHazModel(std::string exportPath,
     }
   }
 
+  lastOptimizeStats = SMeshOptimizeStats();
+  for (Mesh &mesh : modelMeshes) {
+    lastOptimizeStats.Add(
+        OptimizeMesh(mesh.GetMeshData(), meshOptimizeSettings));
+    ComputeMeshBounds(mesh.GetMeshData());
+  }
+  lastOptimizeStats.Log(exportPath.c_str());
+
   AnimatedModelPackage pkg;
   pkg.model = model;
   pkg.meshes = std::move(modelMeshes);
@@ -279,9 +338,7 @@ AnimatedModelManager::LoadAHazModelList(std::vector<std::string> paths) {
 
   auto ids = LoadAHazModelListLimited(paths);
 
-  for (auto &id : ids) {
-    ValidateLoadedFile(id);
-  }
+  ValidateLoadedFiles(ids);
 
   return ids;
 }
@@ -302,9 +359,7 @@ std::vector<ModelID> AnimatedModelManager::LoadAHazModelList(
         std::make_shared<AnimatedModel>(pkg.model);
   }
 
-  for (auto &id : models) {
-    ValidateLoadedFile(id);
-  }
+  ValidateLoadedFiles(models);
 
   return models;
 }
@@ -381,6 +436,34 @@ std::vector<ModelID> AnimatedModelManager::LoadAHazModelListLimited(
   return models;
 }
 void AnimatedModelManager::ValidateLoadedFile(ModelID model) {
+  ValidateLoadedFiles(std::span<const ModelID>(&model, 1));
+}
+
+void AnimatedModelManager::ValidateLoadedFiles(
+    std::span<const ModelID> models) {
+
+  std::vector<MeshID> l_PendingMeshes;
+  std::vector<SStaticMeshUpload> l_Uploads;
+
+  for (const ModelID &model : models) {
+    ValidateModelState(model, l_PendingMeshes, l_Uploads);
+  }
+
+  if (l_Uploads.empty())
+    return;
+
+  std::vector<VertexIndexInfoPair> l_Locations =
+      bufferManager->InsertNewStaticData(l_Uploads,
+                                         TypeFlags::BUFFER_ANIMATED_MESH_DATA);
+
+  for (size_t i = 0; i < l_PendingMeshes.size(); i++) {
+    meshLocations.emplace(l_PendingMeshes[i], l_Locations[i]);
+  }
+}
+
+void AnimatedModelManager::ValidateModelState(
+    ModelID model, std::vector<MeshID> &pendingMeshes,
+    std::vector<SStaticMeshUpload> &uploads) {
 
   auto meshIDs = loadedModels[model]->GetMeshIDs();
 
@@ -388,15 +471,15 @@ void AnimatedModelManager::ValidateLoadedFile(ModelID model) {
 
     Mesh &mesh = meshes[meshID];
 
-    if (!meshLocations.contains(meshID)) {
+    if (!meshLocations.contains(meshID) &&
+        std::find(pendingMeshes.begin(), pendingMeshes.end(), meshID) ==
+            pendingMeshes.end()) {
 
       auto l_vertex = mesh.GetVertexData();
       auto l_index = mesh.GetIndexData();
-      VertexIndexInfoPair l_viipLocation = bufferManager->InsertNewStaticData(
-          l_vertex.first, l_vertex.second, l_index.first, l_index.second,
-          TypeFlags::BUFFER_STATIC_MESH_DATA);
-
-      meshLocations.emplace(meshID, l_viipLocation);
+      uploads.push_back(
+          {l_vertex.first, l_vertex.second, l_index.first, l_index.second});
+      pendingMeshes.push_back(meshID);
     }
 
     if (!skeletons.contains(model)) {
@@ -421,10 +504,13 @@ void AnimatedModelManager::ValidateLoadedFile(ModelID model) {
 }
 void AnimatedModelManager::ValidateLoadedFiles() {
 
+  std::vector<ModelID> l_Models;
+  l_Models.reserve(loadedModels.size());
   for (auto &[modelID, model] : loadedModels) {
-
-    ValidateLoadedFile(modelID);
+    l_Models.push_back(modelID);
   }
+
+  ValidateLoadedFiles(l_Models);
 }
 
 } // namespace eHazGraphics
@@ -14,7 +14,10 @@
 
 #include <cstdint>
 #include <cstring>
+#include <fstream>
 #include <iterator>
+#include <sstream>
+#include <string>
 
 #include <utility>
 #include <vector>
@@ -27,36 +30,34 @@ BufferManager::BufferManager() {}
 
 
 
-void BufferManager::BindDynamicBuffer(TypeFlags type) {
-  CDynamicBuffer *buffer = nullptr;
+CDynamicBuffer *BufferManager::GetDynamicBuffer(TypeFlags type) {
 
   switch (type) {
   case TypeFlags::BUFFER_DRAW_CALL_DATA:
-    buffer = &DrawCommandBuffer;
-    break;
+    return &DrawCommandBuffer;
   case TypeFlags::BUFFER_INSTANCE_DATA:
-    buffer = &InstanceData;
-    break;
+    return &InstanceData;
   case TypeFlags::BUFFER_ANIMATION_DATA:
-    buffer = &AnimationMatrices;
-    break;
+    return &AnimationMatrices;
   case TypeFlags::BUFFER_PARTICLE_DATA:
-    buffer = &ParticleData;
-    break;
+    return &ParticleData;
   case TypeFlags::BUFFER_TEXTURE_DATA:
-    buffer = &TextureHandleBuffer;
-    break;
+    return &TextureHandleBuffer;
   case TypeFlags::BUFFER_CAMERA_DATA:
-    buffer = &cameraMatrices;
-    break;
+    return &cameraMatrices;
   case TypeFlags::BUFFER_LIGHT_DATA:
-    buffer = &LightsBuffer;
-    break;
+    return &LightsBuffer;
   case TypeFlags::BUFFER_STATIC_MATRIX_DATA:
-    buffer = &StaticMatrices;
-
-    break;
+    return &StaticMatrices;
   default:
+    return nullptr;
+  }
+}
+
+void BufferManager::BindDynamicBuffer(TypeFlags type) {
+  CDynamicBuffer *buffer = GetDynamicBuffer(type);
+
+  if (buffer == nullptr) {
     SDL_Log("BindDynamicBuffer: Unknown buffer type %d\n", type);
     return;
   }
@@ -702,27 +703,56 @@ void DynamicBuffer::UpdateOldData(SBufferRange range, const void *data,
 
 
 void BufferManager::Initialize() {
+  // defaults for when there is no profile from a previous session yet
   int d_size = 10;
   int s_size = 16;
 
-  InstanceData = CDynamicBuffer(MBsize(d_size), 0);
-  DrawCommandBuffer = CDynamicBuffer(MBsize(d_size), 1, GL_DRAW_INDIRECT_BUFFER);
-  AnimationMatrices = CDynamicBuffer(MBsize(d_size), 2);
-  TextureHandleBuffer = CDynamicBuffer(MBsize(d_size), 3);
-  ParticleData = CDynamicBuffer(MBsize(d_size), 4);
-  StaticMeshInformation = CGLStaticStack(MBsize(s_size), MBsize(s_size), 5);
-  TerrainBuffer = CGLStaticStack(MBsize(s_size), MBsize(s_size), 6);
+  LoadBufferProfile();
+
+  // ring depth per buffer: data rewritten every frame and read late in the
+  // frame gets more regions, the camera only needs to be one frame ahead
+  InstanceData = CDynamicBuffer(
+      GetProfiledSize(TypeFlags::BUFFER_INSTANCE_DATA, MBsize(d_size)), 0,
+      GL_SHADER_STORAGE_BUFFER, 3);
+  DrawCommandBuffer = CDynamicBuffer(
+      GetProfiledSize(TypeFlags::BUFFER_DRAW_CALL_DATA, MBsize(d_size)), 1,
+      GL_DRAW_INDIRECT_BUFFER);
+  AnimationMatrices = CDynamicBuffer(
+      GetProfiledSize(TypeFlags::BUFFER_ANIMATION_DATA, MBsize(d_size)), 2);
+  TextureHandleBuffer = CDynamicBuffer(
+      GetProfiledSize(TypeFlags::BUFFER_TEXTURE_DATA, MBsize(d_size)), 3);
+  ParticleData = CDynamicBuffer(
+      GetProfiledSize(TypeFlags::BUFFER_PARTICLE_DATA, MBsize(d_size)), 4);
+  StaticMeshInformation = CGLStaticStack(
+      GetProfiledSize(TypeFlags::BUFFER_STATIC_MESH_DATA, MBsize(s_size)),
+      GetProfiledSize(TypeFlags::BUFFER_STATIC_MESH_DATA, MBsize(s_size),
+                      true),
+      5, m_StaticVertexFormat);
+  TerrainBuffer = CGLStaticStack(
+      GetProfiledSize(TypeFlags::BUFFER_STATIC_TERRAIN_DATA, MBsize(s_size)),
+      GetProfiledSize(TypeFlags::BUFFER_STATIC_TERRAIN_DATA, MBsize(s_size),
+                      true),
+      6);
+  AnimatedMeshInformation = CGLStaticStack(
+      GetProfiledSize(TypeFlags::BUFFER_ANIMATED_MESH_DATA, MBsize(s_size)),
+      GetProfiledSize(TypeFlags::BUFFER_ANIMATED_MESH_DATA, MBsize(s_size),
+                      true),
+      12, VertexFormat::FULL, TypeFlags::BUFFER_ANIMATED_MESH_DATA);
 
   // TODO: ADD the other static allocator
 
   // StaticMatrices = StaticBuffer(MBsize(s_size), MBsize(s_size), 7);
-  cameraMatrices = CDynamicBuffer(2 * sizeof(glm::mat4), 8);
-  LightsBuffer = CDynamicBuffer(MBsize(d_size), 9);
-  StaticMatrices =
-      CDynamicBuffer(MBsize(d_size), 10, GL_SHADER_STORAGE_BUFFER, false);
+  cameraMatrices =
+      CDynamicBuffer(2 * sizeof(glm::mat4), 8, GL_SHADER_STORAGE_BUFFER, 2);
+  LightsBuffer = CDynamicBuffer(
+      GetProfiledSize(TypeFlags::BUFFER_LIGHT_DATA, MBsize(d_size)), 9);
+  StaticMatrices = CDynamicBuffer(
+      GetProfiledSize(TypeFlags::BUFFER_STATIC_MATRIX_DATA, MBsize(d_size)),
+      10);
 
   StaticbufferIDs.push_back(&StaticMeshInformation);
   StaticbufferIDs.push_back(&TerrainBuffer);
+  StaticbufferIDs.push_back(&AnimatedMeshInformation);
 
   DynamicBufferIDs.push_back(&InstanceData);
   DynamicBufferIDs.push_back(&AnimationMatrices);
@@ -741,17 +771,205 @@ void BufferManager::Initialize() {
   cameraMatrices.SetBinding(5);
   LightsBuffer.SetBinding(6);
   StaticMatrices.SetBinding(7);
+
+  BuildBufferLookup();
+
+  InstanceRegistry = CInstanceRegistry(&InstanceData, 1024);
+  StaticMatrixPool = CStaticMatrixPool(&StaticMatrices, 1024);
+}
+
+void BufferManager::LoadBufferProfile() {
+
+  m_BufferProfile.clear();
+
+  if (m_sBufferProfilePath.empty())
+    return;
+
+  std::ifstream ifs(m_sBufferProfilePath);
+  if (!ifs.is_open()) {
+    SDL_Log("No buffer profile at %s, using the default buffer sizes",
+            m_sBufferProfilePath.c_str());
+    return;
+  }
+
+  std::string line;
+  while (std::getline(ifs, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream iss(line);
+    uint32_t type = 0;
+    SBufferProfileEntry entry;
+
+    if (!(iss >> type >> entry.size >> entry.indexSize)) {
+      SDL_Log("Skipping malformed buffer profile line: %s", line.c_str());
+      continue;
+    }
+
+    m_BufferProfile[type] = entry;
+  }
+}
+
+void BufferManager::SaveBufferProfile() {
+
+  if (m_sBufferProfilePath.empty())
+    return;
+
+  std::unordered_map<uint32_t, SBufferProfileEntry> l_Session;
+
+  const TypeFlags dynamicTypes[] = {
+      TypeFlags::BUFFER_INSTANCE_DATA,   TypeFlags::BUFFER_DRAW_CALL_DATA,
+      TypeFlags::BUFFER_ANIMATION_DATA,  TypeFlags::BUFFER_TEXTURE_DATA,
+      TypeFlags::BUFFER_PARTICLE_DATA,   TypeFlags::BUFFER_LIGHT_DATA,
+      TypeFlags::BUFFER_STATIC_MATRIX_DATA};
+
+  for (TypeFlags type : dynamicTypes) {
+    l_Session[static_cast<uint32_t>(type)].size =
+        GetDynamicBuffer(type)->GetHighWaterMark();
+  }
+
+  SBufferProfileEntry &mesh =
+      l_Session[static_cast<uint32_t>(TypeFlags::BUFFER_STATIC_MESH_DATA)];
+  mesh.size = std::max(StaticMeshInformation.GetVertexHighWaterMark(),
+                       StaticMeshHeap.GetVertexHighWaterMark());
+  mesh.indexSize = std::max(StaticMeshInformation.GetIndexHighWaterMark(),
+                            StaticMeshHeap.GetIndexHighWaterMark());
+
+  SBufferProfileEntry &terrain =
+      l_Session[static_cast<uint32_t>(TypeFlags::BUFFER_STATIC_TERRAIN_DATA)];
+  terrain.size = TerrainBuffer.GetVertexHighWaterMark();
+  terrain.indexSize = TerrainBuffer.GetIndexHighWaterMark();
+
+  SBufferProfileEntry &animated =
+      l_Session[static_cast<uint32_t>(TypeFlags::BUFFER_ANIMATED_MESH_DATA)];
+  animated.size = AnimatedMeshInformation.GetVertexHighWaterMark();
+  animated.indexSize = AnimatedMeshInformation.GetIndexHighWaterMark();
+
+  std::ofstream ofs(m_sBufferProfilePath, std::ios::trunc);
+  if (!ofs.is_open()) {
+    SDL_Log("Could not write the buffer profile to %s",
+            m_sBufferProfilePath.c_str());
+    return;
+  }
+
+  ofs << "# EnvHazGraphics buffer high-water marks: <TypeFlags> <bytes> "
+         "<index bytes>\n";
+
+  for (auto &[type, entry] : l_Session) {
+
+    // let one small session shrink the sizes only gradually
+    auto it = m_BufferProfile.find(type);
+    if (it != m_BufferProfile.end()) {
+      entry.size = std::max(entry.size, it->second.size * 3 / 4);
+      entry.indexSize = std::max(entry.indexSize, it->second.indexSize * 3 / 4);
+    }
+
+    ofs << type << ' ' << entry.size << ' ' << entry.indexSize << '\n';
+  }
+}
+
+size_t BufferManager::GetProfiledSize(TypeFlags type, size_t fallback,
+                                      bool indexBuffer) const {
+
+  auto it = m_BufferProfile.find(static_cast<uint32_t>(type));
+  if (it == m_BufferProfile.end())
+    return fallback;
+
+  const size_t granularity = 64 * 1024;
+
+  size_t highWater = indexBuffer ? it->second.indexSize : it->second.size;
+
+  // 25% headroom, rounded up to whole 64 KB blocks
+  size_t size = highWater + highWater / 4;
+  size = ((size + granularity - 1) / granularity) * granularity;
+
+  return std::max(size, granularity);
+}
+
+void BufferManager::BuildBufferLookup() {
+
+  m_BufferLookup.clear();
+
+  for (CDynamicBuffer *buffer : DynamicBufferIDs) {
+    uint32_t id = buffer->GetBufferID();
+    if (id >= m_BufferLookup.size())
+      m_BufferLookup.resize(id + 1);
+    m_BufferLookup[id].dynamicBuffer = buffer;
+  }
+
+  for (CGLStaticStack *buffer : StaticbufferIDs) {
+    uint32_t id = buffer->GetStaticStackID();
+    if (id >= m_BufferLookup.size())
+      m_BufferLookup.resize(id + 1);
+    m_BufferLookup[id].staticStack = buffer;
+  }
+
+  if (STATIC_HEAP_ID >= m_BufferLookup.size())
+    m_BufferLookup.resize(STATIC_HEAP_ID + 1);
+  m_BufferLookup[STATIC_HEAP_ID].staticHeap = &StaticMeshHeap;
+}
+
+void BufferManager::GetAllocations(
+    std::span<const SBufferRange> ranges,
+    std::span<std::optional<SAllocation>> allocations) {
+
+  assert(ranges.size() == allocations.size());
+
+  for (size_t i = 0; i < ranges.size(); i++) {
+    allocations[i] = GetAllocation(ranges[i]);
+  }
 }
 void BufferManager::BeginWritting() {
   for (auto &buffer : DynamicBufferIDs) {
     buffer->BeginWritting();
   }
+
+  // rewrite instances that are still stale in the slot we just started
+  InstanceRegistry.Flush();
+  StaticMatrixPool.Reserve();
+
+  StepStaticCompaction();
+}
+
+void BufferManager::StepStaticCompaction() {
+  for (CGLStaticStack *stack : StaticbufferIDs) {
+
+    if (!stack->IsCompacting() && m_fCompactionDeadFraction > 0.0f &&
+        stack->GetDeadBytes() > 0 &&
+        float(stack->GetDeadBytes()) >=
+            m_fCompactionDeadFraction * float(stack->GetUsedBytes())) {
+      stack->BeginCompaction();
+    }
+
+    if (stack->StepCompaction(m_szCompactionBytesPerFrame)) {
+      for (auto &listener : m_StaticRemapListeners) {
+        listener(stack->GetRemapTable());
+      }
+    }
+  }
+}
+
+void BufferManager::RequestStaticCompaction(TypeFlags type) {
+  if (type == TypeFlags::BUFFER_STATIC_MESH_DATA) {
+    StaticMeshInformation.BeginCompaction();
+  } else if (type == TypeFlags::BUFFER_STATIC_TERRAIN_DATA) {
+    TerrainBuffer.BeginCompaction();
+  } else if (type == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+    AnimatedMeshInformation.BeginCompaction();
+  }
 }
 VertexIndexInfoPair BufferManager::InsertNewStaticData(
     const Vertex *vertexData, size_t vertexDataSize, const GLuint *indexData,
     size_t indexDataSize, TypeFlags type = TypeFlags::BUFFER_STATIC_MESH_DATA) {
   // for now only use the StaticMeshInformation, later implement seperation
 
+  // skinned meshes keep their bone attributes in their own stack, whichever
+  // mode the static geometry uses
+  if (type == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+    return AnimatedMeshInformation.push_back(vertexData, vertexDataSize,
+                                             indexData, indexDataSize);
+  }
+
   if (m_bUseStack) {
 
     if (type == TypeFlags::BUFFER_STATIC_MESH_DATA) {
@@ -777,10 +995,78 @@ VertexIndexInfoPair BufferManager::InsertNewStaticData(
                                              indexData, indexDataSize);
     }
   } else {
-    // TODO: IMPLEMENT
+    // terrain goes to the mesh heap, same as it goes to the mesh stack above
+    if (type == TypeFlags::BUFFER_STATIC_MESH_DATA ||
+        type == TypeFlags::BUFFER_STATIC_TERRAIN_DATA) {
+      return GetStaticHeap().Insert(vertexData, vertexDataSize, indexData,
+                                    indexDataSize);
+    }
   }
   return VertexIndexInfoPair();
 }
+
+std::vector<VertexIndexInfoPair>
+BufferManager::InsertNewStaticData(std::span<const SStaticMeshUpload> meshes,
+                                   TypeFlags type) {
+
+  if (type == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+    return AnimatedMeshInformation.push_back(meshes);
+  }
+
+  // same routing as the single mesh overload, terrain shares the mesh storage
+  if (type == TypeFlags::BUFFER_STATIC_MESH_DATA ||
+      type == TypeFlags::BUFFER_STATIC_TERRAIN_DATA) {
+    if (m_bUseStack) {
+      return StaticMeshInformation.push_back(meshes);
+    }
+    return GetStaticHeap().Insert(meshes);
+  }
+
+  return std::vector<VertexIndexInfoPair>(meshes.size());
+}
+
+void BufferManager::BindPulledGeometry(TypeFlags buffer) {
+
+  if (m_glPullVertexArray == 0) {
+    glCreateVertexArrays(1, &m_glPullVertexArray);
+  }
+
+  GLuint indexBuffer = 0;
+
+  if (buffer == TypeFlags::BUFFER_ANIMATED_MESH_DATA || m_bUseStack) {
+    CGLStaticStack *stack = &StaticMeshInformation;
+    if (buffer == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+      stack = &AnimatedMeshInformation;
+    } else if (buffer == TypeFlags::BUFFER_STATIC_TERRAIN_DATA) {
+      stack = &TerrainBuffer;
+    }
+
+    stack->BindStorage(GetPullBinding(stack->GetVertexFormat()),
+                       PULL_BINDING_INDICES);
+    indexBuffer = stack->GetIndexBuffer();
+  } else if (StaticMeshHeap.IsCreated()) {
+    StaticMeshHeap.BindStorage(PULL_BINDING_FULL_VERTICES,
+                               PULL_BINDING_INDICES);
+    indexBuffer = StaticMeshHeap.GetIndexBuffer();
+  } else {
+    return;
+  }
+
+  // only the element buffer is attached, so a regrown buffer never needs the
+  // VAO rebuilt, it is picked up on the next bind
+  glVertexArrayElementBuffer(m_glPullVertexArray, indexBuffer);
+  glBindVertexArray(m_glPullVertexArray);
+}
+
+CGLStaticHeap &BufferManager::GetStaticHeap() {
+  if (!StaticMeshHeap.IsCreated()) {
+    StaticMeshHeap = CGLStaticHeap(
+        GetProfiledSize(TypeFlags::BUFFER_STATIC_MESH_DATA, MBsize(16)),
+        GetProfiledSize(TypeFlags::BUFFER_STATIC_MESH_DATA, MBsize(16), true),
+        STATIC_HEAP_ID);
+  }
+  return StaticMeshHeap;
+}
 SBufferRange BufferManager::InsertNewDynamicData(const void *data, size_t size,
                                                  TypeFlags type) {
 
@@ -812,22 +1098,131 @@ SBufferRange BufferManager::InsertNewDynamicData(const void *data, size_t size,
   SDL_Log("DYNAMIC BUFFER INSERTION ERROR: COULD NOT FIND THE DESIRED TYPE!\n");
   return SBufferRange();
 }
+SBufferRange
+BufferManager::MergeStagingArenas(std::span<CStagingArena *const> arenas) {
+
+  size_t totalInstances = 0;
+  for (CStagingArena *arena : arenas) {
+    totalInstances += arena->GetInstances().size();
+  }
+
+  if (totalInstances == 0)
+    return SBufferRange();
+
+  SBufferRange range = InstanceData.ReserveRange(
+      totalInstances * sizeof(eHazGraphics::InstanceData),
+      TypeFlags::BUFFER_INSTANCE_DATA);
+
+  size_t offset = InstanceData.GetAllocation(range.handle.allocationID)->offset;
+
+  for (CStagingArena *arena : arenas) {
+    const auto &instances = arena->GetInstances();
+
+    arena->SetBaseInstance(
+        static_cast<uint32_t>(offset / sizeof(eHazGraphics::InstanceData)));
+
+    if (instances.empty())
+      continue;
+
+    size_t size = instances.size() * sizeof(eHazGraphics::InstanceData);
+    InstanceData.WriteRange(offset, instances.data(), size);
+    offset += size;
+  }
+
+  return range;
+}
+
 void BufferManager::UpdateData(SBufferRange &range, const void *data,
                                const size_t size) {
 
   const uint16_t bufferID = range.handle.bufferID;
 
-  for (CDynamicBuffer *buffer : DynamicBufferIDs) {
-    if (buffer->GetBufferID() == bufferID) {
-      buffer->UpdateRange(&range, data, size);
-      return;
-    }
+  if (CDynamicBuffer *buffer = GetDynamicBuffer(bufferID)) {
+    buffer->UpdateRange(&range, data, size);
+    return;
   }
 
   SDL_Log("ERROR: BufferManager::UpdateData() - DynamicBuffer ID not found: %u",
           bufferID);
 }
 
+void BufferManager::RemoveRange(const SBufferRange &range) {
+
+  if (CDynamicBuffer *buffer = GetDynamicBuffer(range.handle.bufferID)) {
+    buffer->RemoveItem(range);
+    return;
+  }
+
+  SDL_Log("ERROR: BufferManager::RemoveRange() - DynamicBuffer ID not found: "
+          "%u",
+          range.handle.bufferID);
+}
+
+std::optional<SFragmentationStats>
+BufferManager::GetFragmentationStats(TypeFlags type) {
+
+  CDynamicBuffer *buffer = GetDynamicBuffer(type);
+  if (buffer == nullptr)
+    return std::nullopt;
+
+  return buffer->GetFragmentationStats();
+}
+
+size_t BufferManager::GetBoundSlotOffset(TypeFlags type) {
+
+  CDynamicBuffer *buffer = GetDynamicBuffer(type);
+  if (buffer == nullptr)
+    return 0;
+
+  return buffer->GetSlotBaseOffset(buffer->GetWriteSlot());
+}
+
+std::optional<SResizeStats> BufferManager::GetResizeStats(TypeFlags type) {
+
+  CDynamicBuffer *buffer = GetDynamicBuffer(type);
+  if (buffer == nullptr)
+    return std::nullopt;
+
+  return buffer->GetResizeStats();
+}
+
+void BufferManager::GetMemoryStats(
+    std::vector<SBufferMemoryStats> &stats) const {
+
+  const std::pair<TypeFlags, const CDynamicBuffer *> dynamicBuffers[] = {
+      {TypeFlags::BUFFER_INSTANCE_DATA, &InstanceData},
+      {TypeFlags::BUFFER_DRAW_CALL_DATA, &DrawCommandBuffer},
+      {TypeFlags::BUFFER_ANIMATION_DATA, &AnimationMatrices},
+      {TypeFlags::BUFFER_TEXTURE_DATA, &TextureHandleBuffer},
+      {TypeFlags::BUFFER_PARTICLE_DATA, &ParticleData},
+      {TypeFlags::BUFFER_CAMERA_DATA, &cameraMatrices},
+      {TypeFlags::BUFFER_LIGHT_DATA, &LightsBuffer},
+      {TypeFlags::BUFFER_STATIC_MATRIX_DATA, &StaticMatrices}};
+
+  for (const auto &[type, buffer] : dynamicBuffers) {
+    SBufferMemoryStats &entry = stats.emplace_back(buffer->GetMemoryStats());
+    entry.type = type;
+  }
+
+  SBufferMemoryStats &mesh =
+      stats.emplace_back(StaticMeshInformation.GetMemoryStats());
+  mesh.type = TypeFlags::BUFFER_STATIC_MESH_DATA;
+
+  SBufferMemoryStats &terrain =
+      stats.emplace_back(TerrainBuffer.GetMemoryStats());
+  terrain.type = TypeFlags::BUFFER_STATIC_TERRAIN_DATA;
+
+  SBufferMemoryStats &animated =
+      stats.emplace_back(AnimatedMeshInformation.GetMemoryStats());
+  animated.type = TypeFlags::BUFFER_ANIMATED_MESH_DATA;
+
+  if (StaticMeshHeap.IsCreated()) {
+    SBufferMemoryStats &heap =
+        stats.emplace_back(StaticMeshHeap.GetMemoryStats());
+    heap.type = TypeFlags::BUFFER_STATIC_MESH_DATA;
+  }
+}
+
 void BufferManager::ClearBuffer(TypeFlags whichBuffer) {
 
   if (whichBuffer == TypeFlags::BUFFER_STATIC_MESH_DATA) {
@@ -835,7 +1230,7 @@ void BufferManager::ClearBuffer(TypeFlags whichBuffer) {
     if (m_bUseStack)
       StaticMeshInformation.Clear();
     else {
-      // TODO: IMPLEMENT
+      StaticMeshHeap.Clear();
     }
   }
   if (whichBuffer == TypeFlags::BUFFER_STATIC_TERRAIN_DATA) {
@@ -844,9 +1239,12 @@ void BufferManager::ClearBuffer(TypeFlags whichBuffer) {
     if (m_bUseStack)
       StaticMeshInformation.Clear();
     else {
-      // TODO: IMPLEMENT X2
+      StaticMeshHeap.Clear();
     };
   }
+  if (whichBuffer == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+    AnimatedMeshInformation.Clear();
+  }
   if (whichBuffer == TypeFlags::BUFFER_INSTANCE_DATA) {
     InstanceData.ClearBuffer();
   }
@@ -874,18 +1272,38 @@ void BufferManager::ClearBuffer(TypeFlags whichBuffer) {
 }
 
 void BufferManager::Destroy() {
+  SaveBufferProfile();
+
+  InstanceRegistry.Clear();
+  StaticMatrixPool.Clear();
+
   for (auto &buffer : StaticbufferIDs) {
     buffer->Destroy();
   }
+  if (StaticMeshHeap.IsCreated()) {
+    StaticMeshHeap.Destroy();
+  }
+  if (m_glPullVertexArray != 0) {
+    glDeleteVertexArrays(1, &m_glPullVertexArray);
+    m_glPullVertexArray = 0;
+  }
   for (auto &buffer : DynamicBufferIDs) {
     buffer->Destroy();
   }
 }
 void BufferManager::EndWritting() {
+  // matrices changed this frame go out in one pass before the slot is fenced
+  StaticMatrixPool.Flush();
+
   for (auto &buffer : DynamicBufferIDs) {
     buffer->EndWritting();
   }
 }
+void BufferManager::FenceWrittenSlots() {
+  for (auto &buffer : DynamicBufferIDs) {
+    buffer->FenceCurrentSlot();
+  }
+}
 void BufferManager::UpdateManager() {}
 
 } // namespace eHazGraphics
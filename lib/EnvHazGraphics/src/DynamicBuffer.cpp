@@ -7,153 +7,99 @@ namespace eHazGraphics {
 CDynamicBuffer::CDynamicBuffer() {}
 
 CDynamicBuffer::CDynamicBuffer(size_t p_szInitialSize, int p_iDynamicBufferID,
-                               GLenum p_gleTarget, bool p_bTrippleBuffer) {
+                               GLenum p_gleTarget, uint32_t p_uiRingDepth) {
   m_szBufferSize = p_szInitialSize;
   m_uiDynamicBufferID = p_iDynamicBufferID;
   m_gleTarget = p_gleTarget;
-  m_bUseTrippleBuffering = p_bTrippleBuffer;
-
-  if (m_bUseTrippleBuffering) {
-
-    glCreateBuffers(1, &m_uiSlotIDs[0]);
-    glCreateBuffers(1, &m_uiSlotIDs[1]);
-    glCreateBuffers(1, &m_uiSlotIDs[2]);
-
-    glNamedBufferStorage(m_uiSlotIDs[0], p_szInitialSize, nullptr,
-                         GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
-                             GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
-    glNamedBufferStorage(m_uiSlotIDs[1], p_szInitialSize, nullptr,
-                         GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
-                             GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
-    glNamedBufferStorage(m_uiSlotIDs[2], p_szInitialSize, nullptr,
-                         GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
-                             GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
-  } else {
-    glCreateBuffers(1, &m_uiSlotIDs[0]);
-    glNamedBufferStorage(m_uiSlotIDs[0], p_szInitialSize, nullptr,
-                         GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
-                             GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+  m_uiRingDepth = std::clamp<uint32_t>(p_uiRingDepth, 1, MAX_RING_DEPTH);
+
+  GLint l_iAlignment = 0;
+  switch (m_gleTarget) {
+  case GL_SHADER_STORAGE_BUFFER:
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &l_iAlignment);
+    break;
+  case GL_UNIFORM_BUFFER:
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &l_iAlignment);
+    break;
+  default:
+    break;
   }
+  m_szRegionAlignment = std::max<size_t>(l_iAlignment, 256);
+
+  m_szRegionStride = AlignRegionSize(m_szBufferSize);
+
+  // one buffer, each ring slot is a region of it
+  glCreateBuffers(1, &m_uiBufferObject);
+  glNamedBufferStorage(m_uiBufferObject, m_szRegionStride * m_uiRingDepth,
+                       nullptr,
+                       GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
+                           GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
 
   MapAllBufferSlots();
 
 #ifdef EHAZ_DEBUG
   GLint result = 0;
-  glGetNamedBufferParameteriv(m_uiSlotIDs[0], GL_BUFFER_SIZE, &result);
-  SDL_Log("Buffer %u size = %d", m_uiSlotIDs[0], result);
-
-  GLint result1 = 0;
-  glGetNamedBufferParameteriv(m_uiSlotIDs[1], GL_BUFFER_SIZE, &result1);
-  SDL_Log("Buffer %u size = %d", m_uiSlotIDs[1], result1);
-
-  GLint result2 = 0;
-  glGetNamedBufferParameteriv(m_uiSlotIDs[2], GL_BUFFER_SIZE, &result2);
-  SDL_Log("Buffer %u size = %d", m_uiSlotIDs[2], result2);
+  glGetNamedBufferParameteriv(m_uiBufferObject, GL_BUFFER_SIZE, &result);
+  SDL_Log("Buffer %u size = %d (%u regions)", m_uiBufferObject, result,
+          m_uiRingDepth);
 #endif
 }
-template <typename T>
-SBufferRange CDynamicBuffer::InsertNewData(const T *p_pData, size_t p_szSize,
-                                           TypeFlags p_tfType) {
-
-  if (std::is_same<T, void>::value == true) {
-    return InsertNewData(p_pData, p_szSize, p_tfType);
-  }
-
-  if (p_szSize >= m_szBufferSize ||
-      p_szSize + m_szOccupiedSize[GetWriteSlot()] >= m_szBufferSize) {
-    m_bSlotResizeState = true;
-    ResizeBuffer(p_szSize);
-  }
-
-  int slot = GetWriteSlot();
-
-  std::byte *base = static_cast<std::byte *>(m_pSlots[slot]);
-  T *l_pWriteLocation = reinterpret_cast<T *>(base + m_szWriteCursor[slot]);
-
-  uint32_t count = 1;
-
-  std::memcpy(l_pWriteLocation, p_pData, p_szSize);
-  count = p_szSize / sizeof(T);
-
-  uint32_t allocID = AllocateID(p_szSize);
-  SAllocation &l_allocation = m_Allocations[allocID];
 
-  l_allocation.alive = true;
-  l_allocation.generation++;
-  l_allocation.offset = m_szWriteCursor[slot];
-  l_allocation.size = p_szSize;
-
-  SBufferHandle handle;
-  handle.allocationID = allocID;
-  handle.bufferID = m_uiDynamicBufferID;
-  handle.slot = GetDynamicSlotType(slot);
-  handle.generation = l_allocation.generation;
+SBufferRange CDynamicBuffer::InsertNewData(const void *p_pData, size_t p_szSize,
+                                           TypeFlags p_tfType) {
 
-  m_szOccupiedSize[slot] += p_szSize;
+  SBufferRange l_Range = ReserveRange(p_szSize, p_tfType);
 
-  SBufferRange l_Range;
-  l_Range.count = count;
-  l_Range.dataType = p_tfType;
-  l_Range.handle = handle;
-
-  m_szWriteCursor[slot] += p_szSize;
-  m_szOccupiedSize[slot] += p_szSize;
+  std::memcpy(
+      GetWritePointer(m_Allocations[l_Range.handle.allocationID].offset),
+      p_pData, p_szSize);
 
   return l_Range;
 }
 
-SBufferRange CDynamicBuffer::InsertNewData(const void *p_pData, size_t p_szSize,
-                                           TypeFlags p_tfType) {
-
-  if (p_szSize >= m_szBufferSize ||
-      p_szSize + m_szOccupiedSize[GetWriteSlot()] >= m_szBufferSize) {
-    m_bSlotResizeState = true;
-    ResizeBuffer(p_szSize);
-  }
-
-  int slot = GetWriteSlot();
+SBufferRange CDynamicBuffer::ReserveRange(size_t p_szSize,
+                                          TypeFlags p_tfType) {
 
-  std::byte *l_pWriteLocation =
-      static_cast<std::byte *>(m_pSlots[slot]) + m_szWriteCursor[slot];
   uint32_t count = 1;
 
   switch (p_tfType) {
   case TypeFlags::BUFFER_INSTANCE_DATA:
     count = p_szSize / sizeof(InstanceData);
-    std::memcpy(reinterpret_cast<InstanceData *>(l_pWriteLocation), p_pData,
-                p_szSize);
     break;
   case TypeFlags::BUFFER_CAMERA_DATA:
   case TypeFlags::BUFFER_ANIMATION_DATA:
   case TypeFlags::BUFFER_STATIC_MATRIX_DATA:
     count = p_szSize / sizeof(glm::mat4);
-    std::memcpy(reinterpret_cast<glm::mat4 *>(l_pWriteLocation), p_pData,
-                p_szSize);
     break;
   case TypeFlags::BUFFER_DRAW_CALL_DATA:
     count = p_szSize / sizeof(DrawElementsIndirectCommand);
-    std::memcpy(
-        reinterpret_cast<DrawElementsIndirectCommand *>(l_pWriteLocation),
-        p_pData, p_szSize);
     break;
   case TypeFlags::BUFFER_TEXTURE_DATA:
     count = p_szSize / sizeof(GLuint64);
-    std::memcpy(reinterpret_cast<GLuint64 *>(l_pWriteLocation), p_pData,
-                p_szSize);
     break;
   case TypeFlags::BUFFER_LIGHT_DATA:
   case TypeFlags::BUFFER_PARTICLE_DATA:
   default:
-    std::memcpy(l_pWriteLocation, p_pData, p_szSize);
     break;
   }
 
+  return ReserveElements(p_szSize, count, p_tfType);
+}
+
+SBufferRange CDynamicBuffer::ReserveElements(size_t p_szSize,
+                                             uint32_t p_uiCount,
+                                             TypeFlags p_tfType) {
+
+  size_t l_szOffset = AllocateRange(p_szSize);
+
+  int slot = GetWriteSlot();
+
   uint32_t allocID = AllocateID(p_szSize);
   SAllocation &l_allocation = m_Allocations[allocID];
 
   l_allocation.alive = true;
   l_allocation.generation++;
-  l_allocation.offset = m_szWriteCursor[slot];
+  l_allocation.offset = l_szOffset;
   l_allocation.size = p_szSize;
 
   SBufferHandle handle;
@@ -163,21 +109,109 @@ SBufferRange CDynamicBuffer::InsertNewData(const void *p_pData, size_t p_szSize,
   handle.generation = l_allocation.generation;
 
   SBufferRange l_Range;
-  l_Range.count = count;
+  l_Range.count = p_uiCount;
   l_Range.dataType = p_tfType;
   l_Range.handle = handle;
 
-  m_szWriteCursor[slot] += p_szSize;
-  m_szOccupiedSize[slot] += p_szSize;
-
   return l_Range;
-
-  return SBufferRange();
 }
 
 void CDynamicBuffer::UpdateRange(SBufferRange *p_brRange, const void *p_pData,
                                  size_t p_szDataSize) {
+
+  const SBufferHandle &handle = p_brRange->handle;
+
+  // ranges from a slot the GPU may still read (or from before the last clear)
+  // can not be touched, they simply get a fresh block in the write slot
+  if (!IsLiveAllocation(handle) ||
+      GetDynamicSlotID(handle.slot) != static_cast<int>(GetWriteSlot())) {
+    *p_brRange = InsertNewData(p_pData, p_szDataSize, p_brRange->dataType);
+    return;
+  }
+
+  SAllocation &l_allocation = m_Allocations[handle.allocationID];
+
+  if (p_szDataSize <= l_allocation.size) {
+
+    std::memcpy(GetWritePointer(l_allocation.offset), p_pData, p_szDataSize);
+
+    if (p_szDataSize < l_allocation.size) {
+      // keep the element count in step with the shrunk block
+      p_brRange->count = static_cast<uint32_t>(
+          (uint64_t)p_brRange->count * p_szDataSize / l_allocation.size);
+
+      ReleaseRange(l_allocation.offset + p_szDataSize,
+                   l_allocation.size - p_szDataSize);
+      l_allocation.size = p_szDataSize;
+    }
+
+    m_uiInPlaceUpdates++;
+    return;
+  }
+
+  RemoveItem(*p_brRange);
   *p_brRange = InsertNewData(p_pData, p_szDataSize, p_brRange->dataType);
+  m_uiReallocatedUpdates++;
+}
+
+void CDynamicBuffer::RemoveItem(const SBufferRange &p_brRange) {
+
+  const SBufferHandle &handle = p_brRange.handle;
+
+  if (!IsLiveAllocation(handle)) {
+    SDL_Log("RemoveItem: stale or unknown allocation %u on buffer %u",
+            handle.allocationID, m_uiDynamicBufferID);
+    return;
+  }
+
+  SAllocation &l_allocation = m_Allocations[handle.allocationID];
+
+  // blocks of older slots die with the next ClearBuffer() of that slot
+  if (GetDynamicSlotID(handle.slot) == static_cast<int>(GetWriteSlot())) {
+    ReleaseRange(l_allocation.offset, l_allocation.size);
+  }
+
+  l_allocation.alive = false;
+  m_FreeAllocationIDs.push_back(handle.allocationID);
+}
+
+SFragmentationStats CDynamicBuffer::GetFragmentationStats() const {
+
+  SFragmentationStats l_Stats;
+  l_Stats.usedBytes = m_szOccupiedSize[m_iNextSlot];
+  l_Stats.freeBlockCount = static_cast<uint32_t>(m_FreeBlocks.size());
+  l_Stats.inPlaceUpdates = m_uiInPlaceUpdates;
+  l_Stats.reallocatedUpdates = m_uiReallocatedUpdates;
+
+  for (const auto &[offset, size] : m_FreeBlocks) {
+    l_Stats.freeBytes += size;
+    l_Stats.largestFreeBlock = std::max(l_Stats.largestFreeBlock, size);
+  }
+
+  return l_Stats;
+}
+
+SBufferMemoryStats CDynamicBuffer::GetMemoryStats() const {
+
+  SBufferMemoryStats l_Stats;
+  l_Stats.capacityBytes = m_szRegionStride * m_uiRingDepth;
+  l_Stats.wastedBytes = (m_szRegionStride - m_szBufferSize) * m_uiRingDepth;
+
+  for (uint32_t i = 0; i < m_uiRingDepth; i++) {
+    l_Stats.occupiedBytes += m_szOccupiedSize[i];
+  }
+
+  // only the write slot keeps a free list, the others are rebuilt on reuse
+  for (const auto &[offset, size] : m_FreeBlocks) {
+    l_Stats.wastedBytes += size;
+  }
+
+  for (const SRetiredBuffer &retired : m_RetiredBuffers) {
+    l_Stats.capacityBytes += retired.size;
+    l_Stats.wastedBytes += retired.size;
+  }
+
+  return l_Stats;
 }
 
 void CDynamicBuffer::ResizeBuffer(size_t p_szMinimumSize) {
@@ -188,76 +222,180 @@ void CDynamicBuffer::ResizeBuffer(size_t p_szMinimumSize) {
   size_t l_newSize = std::max(2 * m_szBufferSize, p_szMinimumSize);
   // #endif
 
-  if (m_bSlotResizeState) {
-    if (m_bUseTrippleBuffering) {
+  if (!m_bSlotResizeState)
+    return;
 
-      for (int i = 0; i < 3; i++) {
+  m_szBufferSize = l_newSize;
+  m_uiResizeCount++;
+  m_bResizeStalled = false;
 
-        WaitForSlotFence(i);
+  int l_writeSlot = GetWriteSlot();
 
-        GLuint l_gluiNewBuffer;
-        glCreateBuffers(1, &l_gluiNewBuffer);
-        glNamedBufferStorage(l_gluiNewBuffer, l_newSize, nullptr,
-                             GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
-                                 GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+  // Nothing here waits on the GPU: the old contents are copied on the GPU
+  // timeline, the CPU keeps writing into the new mapping past the copied bytes
+  // and the old buffer is only deleted once its fence signals.
+  size_t l_szOldStride = m_szRegionStride;
+  m_szRegionStride = AlignRegionSize(l_newSize);
 
-        glCopyNamedBufferSubData(m_uiSlotIDs[i], l_gluiNewBuffer, 0, 0,
-                                 m_szOccupiedSize[i]);
+  GLuint l_gluiNewBuffer;
+  glCreateBuffers(1, &l_gluiNewBuffer);
+  glNamedBufferStorage(l_gluiNewBuffer, m_szRegionStride * m_uiRingDepth,
+                       nullptr,
+                       GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
+                           GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
 
-        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
-        glDeleteSync(fence);
+  for (uint32_t i = 0; i < m_uiRingDepth; i++) {
 
-        glDeleteBuffers(1, &m_uiSlotIDs[i]);
+    // the other slots get rebuilt after their next ClearBuffer(), they only
+    // need to keep the persistent region
+    size_t l_szCopySize =
+        (int(i) == l_writeSlot) ? m_szWriteCursor[i] : m_szPersistentSize;
 
-        m_uiSlotIDs[i] = l_gluiNewBuffer;
-      }
+    if (l_szCopySize > 0) {
+      glCopyNamedBufferSubData(m_uiBufferObject, l_gluiNewBuffer,
+                               i * l_szOldStride, i * m_szRegionStride,
+                               l_szCopySize);
+    }
+
+    m_szCopyLimit[i] = l_szCopySize;
+  }
+
+  // a newer copy is ordered after any older one, so its fence covers both
+  if (m_glsCopyFence) {
+    glDeleteSync(m_glsCopyFence);
+  }
+  m_glsCopyFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  SRetiredBuffer l_Retired;
+  l_Retired.buffer = m_uiBufferObject;
+  l_Retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  l_Retired.size = l_szOldStride * m_uiRingDepth;
+  m_RetiredBuffers.push_back(l_Retired);
 
-      MapAllBufferSlots();
-      m_bSlotResizeState = false;
-      return;
+  m_uiBufferObject = l_gluiNewBuffer;
+  MapAllBufferSlots();
+
+  glFlush();
+
+  m_bSlotResizeState = false;
+}
+
+void CDynamicBuffer::ReleaseRetiredBuffers() {
+
+  auto it = m_RetiredBuffers.begin();
+  while (it != m_RetiredBuffers.end()) {
+
+    GLenum res = glClientWaitSync(it->fence, 0, 0);
+    if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED) {
+      ++it;
+      continue;
     }
 
-    int l_slot = GetWriteSlot();
-    WaitForSlotFence(l_slot);
+    glDeleteSync(it->fence);
+    glUnmapNamedBuffer(it->buffer);
+    glDeleteBuffers(1, &it->buffer);
+    it = m_RetiredBuffers.erase(it);
+  }
+}
 
-    GLuint l_gluiNewBuffer;
-    glCreateBuffers(1, &l_gluiNewBuffer);
-    glNamedBufferStorage(l_gluiNewBuffer, l_newSize, nullptr,
-                         GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT |
-                             GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT);
+std::byte *CDynamicBuffer::GetWritePointer(size_t p_szOffset) {
 
-    glCopyNamedBufferSubData(m_uiSlotIDs[l_slot], l_gluiNewBuffer, 0, 0,
-                             m_szOccupiedSize[l_slot]);
+  int slot = GetWriteSlot();
 
-    GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
-    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
-    glDeleteSync(fence);
+  // only bytes the pending resize copy will still land on have to wait
+  if (m_glsCopyFence && p_szOffset < m_szCopyLimit[slot]) {
 
-    glDeleteBuffers(1, &m_uiSlotIDs[l_slot]);
+    GLenum res =
+        glClientWaitSync(m_glsCopyFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
 
-    m_uiSlotIDs[l_slot] = l_gluiNewBuffer;
+    if (res != GL_ALREADY_SIGNALED && res != GL_CONDITION_SATISFIED) {
+      glClientWaitSync(m_glsCopyFence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
 
-    m_pSlots[l_slot] = glMapNamedBuffer(
-        l_gluiNewBuffer,
-        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+      if (!m_bResizeStalled) {
+        m_bResizeStalled = true;
+        m_uiStallingResizes++;
+      }
+    }
 
-    m_bSlotResizeState = false;
-    return;
+    glDeleteSync(m_glsCopyFence);
+    m_glsCopyFence = 0;
+    for (uint32_t i = 0; i < MAX_RING_DEPTH; i++) {
+      m_szCopyLimit[i] = 0;
+    }
   }
+
+  return static_cast<std::byte *>(m_pSlots[slot]) + p_szOffset;
+}
+
+SResizeStats CDynamicBuffer::GetResizeStats() const {
+
+  SResizeStats l_Stats;
+  l_Stats.stallingResizes = m_uiStallingResizes;
+  l_Stats.stallFreeResizes = m_uiResizeCount - m_uiStallingResizes;
+  l_Stats.pendingRetirements = static_cast<uint32_t>(m_RetiredBuffers.size());
+  return l_Stats;
 }
 
 void CDynamicBuffer::ClearBuffer() {
   int slot = m_iNextSlot;
-  m_szWriteCursor[slot] = 0;
-  m_szOccupiedSize[slot] = 0;
-  m_Allocations.clear();
+  m_szWriteCursor[slot] = m_szPersistentSize;
+  m_szOccupiedSize[slot] = m_szPersistentSize;
+
+  // keep the IDs around so generations stay unique and stale handles from the
+  // previous frames are rejected
+  m_FreeAllocationIDs.clear();
+  for (uint32_t i = 0; i < m_Allocations.size(); i++) {
+    m_Allocations[i].alive = false;
+    m_FreeAllocationIDs.push_back(i);
+  }
+  ResetFreeBlocks();
 
   if (m_bSlotResizeState) {
     ResizeBuffer();
   }
 }
 
+bool CDynamicBuffer::ReservePersistentRegion(size_t p_szSize) {
+  if (p_szSize <= m_szPersistentSize)
+    return true;
+
+  int slot = GetWriteSlot();
+
+  // growing past transient data would alias allocations handed out this frame
+  if (m_szWriteCursor[slot] != m_szPersistentSize) {
+    SDL_Log("ReservePersistentRegion: buffer %u write slot %d already holds "
+            "transient data, deferring growth",
+            m_uiDynamicBufferID, slot);
+    return false;
+  }
+
+  if (p_szSize >= m_szBufferSize) {
+    m_bSlotResizeState = true;
+    ResizeBuffer(p_szSize);
+  }
+
+  m_szPersistentSize = p_szSize;
+  m_szWriteCursor[slot] = p_szSize;
+  m_szOccupiedSize[slot] = p_szSize;
+  m_szHighWaterMark = std::max(m_szHighWaterMark, p_szSize);
+
+  return true;
+}
+
+void CDynamicBuffer::WriteRange(size_t p_szOffset, const void *p_pData,
+                                size_t p_szSize) {
+  int slot = GetWriteSlot();
+
+  if (m_pSlots[slot] == nullptr || p_szOffset + p_szSize > m_szBufferSize) {
+    SDL_Log("WriteRange: out of range write (offset %zu, size %zu) on buffer "
+            "%u",
+            p_szOffset, p_szSize, m_uiDynamicBufferID);
+    return;
+  }
+
+  std::memcpy(GetWritePointer(p_szOffset), p_pData, p_szSize);
+}
+
 std::optional<SAllocation> CDynamicBuffer::GetAllocation(int p_AllocationID) {
 
   if (p_AllocationID >= m_Allocations.size()) {
@@ -275,81 +413,190 @@ int CDynamicBuffer::GetBufferID() { return m_uiDynamicBufferID; }
 
 void CDynamicBuffer::BeginWritting() {
 
-  if (m_bUseTrippleBuffering) {
-    bool found = false;
-    for (int i = 0; i < 3; ++i) {
-      int candidate = (m_iCurrentSlot + i + 1) % 3;
-      if (WaitForSlotFence(candidate)) {
-        m_iNextSlot = candidate;
-        found = true;
-        break;
-      }
+  bool found = false;
+  for (uint32_t i = 0; i < m_uiRingDepth; ++i) {
+    int candidate = (m_iCurrentSlot + i + 1) % m_uiRingDepth;
+    if (WaitForSlotFence(candidate)) {
+      m_iNextSlot = candidate;
+      found = true;
+      break;
     }
+  }
 
-    if (!found) {
-      // No free slot found, force wait on the oldest slot
-
-      auto max = std::max_element(m_uiSlotAge, m_uiSlotAge + 3);
-      int oldest = std::distance(m_uiSlotAge, max);
-
-      GLenum waitRes = glClientWaitSync(
-          m_glsFences[oldest], GL_SYNC_FLUSH_COMMANDS_BIT, GLuint64(1e9));
-      if (waitRes == GL_TIMEOUT_EXPIRED)
-        SDL_Log(
-            "Warning: GPU still not finished with buffer slot %d, forced wait",
-            oldest);
+  if (!found) {
+    // No free region, the next one in the ring is the oldest. It is never
+    // handed out before the GPU is done with it, otherwise the frame in flight
+    // would read what we are about to write.
+    int oldest = (m_iCurrentSlot + 1) % m_uiRingDepth;
+    m_uiForcedWaits++;
+
+    while (glClientWaitSync(m_glsFences[oldest], GL_SYNC_FLUSH_COMMANDS_BIT,
+                            GLuint64(1e9)) == GL_TIMEOUT_EXPIRED) {
+      SDL_Log(
+          "Warning: GPU still not finished with buffer slot %d, forced wait",
+          oldest);
+    }
 
-      glDeleteSync(m_glsFences[oldest]);
-      m_glsFences[oldest] = 0;
-      m_uiSlotAge[oldest] = 0;
+    glDeleteSync(m_glsFences[oldest]);
+    m_glsFences[oldest] = 0;
+    m_uiSlotAge[oldest] = 0;
 
-      m_iNextSlot = oldest;
-    }
-  } else {
-    m_iNextSlot = 0;
-    m_iCurrentSlot = 0;
+    m_iNextSlot = oldest;
   }
+
+  ReleaseRetiredBuffers();
   ClearBuffer();
 }
 
 void CDynamicBuffer::EndWritting() {
-  glBindBuffer(m_gleTarget, m_uiSlotIDs[m_iNextSlot]);
-
-  // Place fence for the slot we just wrote (nextSlot)
-  // We set fence for nextSlot explicitly so waitForSlotFence checks the right
-  // sync object.
-  SetDownFence(m_iNextSlot);
-
-  // Commit swap: nextSlot becomes current slot used for rendering
+  // Commit swap: nextSlot becomes current slot used for rendering. The fence
+  // goes down in FenceCurrentSlot() once the draws reading it are submitted.
   m_iCurrentSlot = m_iNextSlot;
 }
 
+void CDynamicBuffer::FenceCurrentSlot() { SetDownFence(m_iCurrentSlot); }
+
 void CDynamicBuffer::Destroy() {
-  for (int i = 0; i < 3; ++i) {
-    if (m_pSlots[i]) {
-      // unmap if mapped
-      glUnmapNamedBuffer(m_uiSlotIDs[i]);
-      m_pSlots[i] = nullptr;
-    }
+  if (m_pMapped) {
+    // unmap if mapped
+    glUnmapNamedBuffer(m_uiBufferObject);
+    m_pMapped = nullptr;
+  }
+  for (uint32_t i = 0; i < MAX_RING_DEPTH; ++i) {
+    m_pSlots[i] = nullptr;
     if (m_glsFences[i]) {
       glDeleteSync(m_glsFences[i]);
       m_glsFences[i] = 0;
     }
-    if (glIsBuffer(m_uiSlotIDs[i])) {
-      glDeleteBuffers(1, &m_uiSlotIDs[i]);
-    }
-    m_uiSlotIDs[i] = 0;
   }
+  if (m_glsCopyFence) {
+    glDeleteSync(m_glsCopyFence);
+    m_glsCopyFence = 0;
+  }
+  if (glIsBuffer(m_uiBufferObject)) {
+    glDeleteBuffers(1, &m_uiBufferObject);
+  }
+  m_uiBufferObject = 0;
+
+  for (SRetiredBuffer &retired : m_RetiredBuffers) {
+    glDeleteSync(retired.fence);
+    glUnmapNamedBuffer(retired.buffer);
+    glDeleteBuffers(1, &retired.buffer);
+  }
+  m_RetiredBuffers.clear();
 }
 
 uint32_t CDynamicBuffer::AllocateID(size_t p_szMinimumSize) {
 
-  // for now nothing since we arent storing Allocations for a free list
+  if (!m_FreeAllocationIDs.empty()) {
+    uint32_t l_uiID = m_FreeAllocationIDs.back();
+    m_FreeAllocationIDs.pop_back();
+    return l_uiID;
+  }
 
   m_Allocations.push_back(SAllocation());
   return m_Allocations.size() - 1;
+}
 
-  // return 0;
+size_t CDynamicBuffer::AllocateRange(size_t p_szSize) {
+
+  int slot = GetWriteSlot();
+
+  // best fit from the holes first
+  auto fit = m_FreeBlocksBySize.lower_bound(p_szSize);
+  if (fit != m_FreeBlocksBySize.end()) {
+    size_t l_szOffset = fit->second;
+    size_t l_szBlockSize = fit->first;
+
+    EraseFreeBlock(m_FreeBlocks.find(l_szOffset));
+
+    if (l_szBlockSize > p_szSize) {
+      InsertFreeBlock(l_szOffset + p_szSize, l_szBlockSize - p_szSize);
+    }
+
+    m_szOccupiedSize[slot] += p_szSize;
+    return l_szOffset;
+  }
+
+  if (p_szSize >= m_szBufferSize ||
+      p_szSize + m_szWriteCursor[slot] >= m_szBufferSize) {
+    m_bSlotResizeState = true;
+    ResizeBuffer(p_szSize + m_szWriteCursor[slot]);
+  }
+
+  size_t l_szOffset = m_szWriteCursor[slot];
+  m_szWriteCursor[slot] += p_szSize;
+  m_szOccupiedSize[slot] += p_szSize;
+  m_szHighWaterMark = std::max(m_szHighWaterMark, m_szWriteCursor[slot]);
+
+  return l_szOffset;
+}
+
+void CDynamicBuffer::ReleaseRange(size_t p_szOffset, size_t p_szSize) {
+
+  if (p_szSize == 0)
+    return;
+
+  int slot = GetWriteSlot();
+  m_szOccupiedSize[slot] -= p_szSize;
+
+  // merge with the free block right before it
+  auto next = m_FreeBlocks.lower_bound(p_szOffset);
+  if (next != m_FreeBlocks.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == p_szOffset) {
+      p_szOffset = prev->first;
+      p_szSize += prev->second;
+      EraseFreeBlock(prev);
+    }
+  }
+
+  // and the one right after it
+  next = m_FreeBlocks.lower_bound(p_szOffset);
+  if (next != m_FreeBlocks.end() && p_szOffset + p_szSize == next->first) {
+    p_szSize += next->second;
+    EraseFreeBlock(next);
+  }
+
+  // a hole touching the cursor just hands the space back to the bump region
+  if (p_szOffset + p_szSize == m_szWriteCursor[slot]) {
+    m_szWriteCursor[slot] = p_szOffset;
+    return;
+  }
+
+  InsertFreeBlock(p_szOffset, p_szSize);
+}
+
+void CDynamicBuffer::InsertFreeBlock(size_t p_szOffset, size_t p_szSize) {
+  m_FreeBlocks[p_szOffset] = p_szSize;
+  m_FreeBlocksBySize.emplace(p_szSize, p_szOffset);
+}
+
+void CDynamicBuffer::EraseFreeBlock(std::map<size_t, size_t>::iterator p_it) {
+
+  auto range = m_FreeBlocksBySize.equal_range(p_it->second);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == p_it->first) {
+      m_FreeBlocksBySize.erase(it);
+      break;
+    }
+  }
+
+  m_FreeBlocks.erase(p_it);
+}
+
+void CDynamicBuffer::ResetFreeBlocks() {
+  m_FreeBlocks.clear();
+  m_FreeBlocksBySize.clear();
+}
+
+bool CDynamicBuffer::IsLiveAllocation(const SBufferHandle &p_Handle) const {
+
+  if (p_Handle.allocationID >= m_Allocations.size())
+    return false;
+
+  const SAllocation &l_allocation = m_Allocations[p_Handle.allocationID];
+  return l_allocation.alive && l_allocation.generation == p_Handle.generation;
 }
 
 SlotType CDynamicBuffer::GetDynamicSlotType(int p_ID) {
@@ -363,6 +610,9 @@ SlotType CDynamicBuffer::GetDynamicSlotType(int p_ID) {
   case 2:
     return SlotType::DYNAMIC_SLOT_3;
     break;
+  case 3:
+    return SlotType::DYNAMIC_SLOT_4;
+    break;
   default:
     return SlotType::SLOT_NONE;
     break;
@@ -382,13 +632,16 @@ int CDynamicBuffer::GetDynamicSlotID(SlotType p_type) {
   case SlotType::DYNAMIC_SLOT_3:
     return 2;
     break;
-  case SlotType::SLOT_NONE:
+  case SlotType::DYNAMIC_SLOT_4:
+    return 3;
+    break;
+  default:
     return -1;
   }
 }
 
 void CDynamicBuffer::SetDownFence(int p_Slot) {
-  if (p_Slot < 0 || p_Slot >= 3)
+  if (p_Slot < 0 || p_Slot >= int(m_uiRingDepth))
     return;
 
   if (m_glsFences[p_Slot]) {
@@ -401,17 +654,32 @@ void CDynamicBuffer::SetDownFence(int p_Slot) {
 }
 
 void CDynamicBuffer::MapAllBufferSlots() {
-  for (unsigned int i = 0; i < 3; i++) {
 
-    if (glIsBuffer(m_uiSlotIDs[i])) {
+  m_pMapped = nullptr;
+  for (uint32_t i = 0; i < MAX_RING_DEPTH; i++) {
+    m_pSlots[i] = nullptr;
+  }
 
-      m_pSlots[i] = glMapNamedBufferRange(
-          m_uiSlotIDs[i], 0, m_szBufferSize,
-          GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
-    }
+  if (!glIsBuffer(m_uiBufferObject))
+    return;
+
+  m_pMapped = glMapNamedBufferRange(
+      m_uiBufferObject, 0, m_szRegionStride * m_uiRingDepth,
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+
+  if (m_pMapped == nullptr)
+    return;
+
+  for (uint32_t i = 0; i < m_uiRingDepth; i++) {
+    m_pSlots[i] = static_cast<std::byte *>(m_pMapped) + i * m_szRegionStride;
   }
 }
 
+size_t CDynamicBuffer::AlignRegionSize(size_t p_szSize) const {
+  return (p_szSize + m_szRegionAlignment - 1) / m_szRegionAlignment *
+         m_szRegionAlignment;
+}
+
 bool CDynamicBuffer::WaitForSlotFence(int p_Slot) {
   if (m_glsFences[p_Slot] == 0)
     return true;
@@ -430,26 +698,23 @@ bool CDynamicBuffer::WaitForSlotFence(int p_Slot) {
 }
 
 void CDynamicBuffer::SetSlot(int p_Slot) {
-  if (m_bUseTrippleBuffering) {
-    m_iCurrentSlot = p_Slot;
-  } else {
-    m_iCurrentSlot = 0;
-  }
+  m_iCurrentSlot = p_Slot % m_uiRingDepth;
 
   switch (m_gleTarget) {
   case GL_SHADER_STORAGE_BUFFER:
   case GL_UNIFORM_BUFFER:
   case GL_ATOMIC_COUNTER_BUFFER:
   case GL_TRANSFORM_FEEDBACK_BUFFER:
-    // Indexed binding targets
+    // Indexed binding targets, only the region of this slot is visible
 
-    glBindBufferBase(m_gleTarget, m_iBinding, m_uiSlotIDs[m_iCurrentSlot]);
+    glBindBufferRange(m_gleTarget, m_iBinding, m_uiBufferObject,
+                      GetSlotBaseOffset(m_iCurrentSlot), m_szRegionStride);
     break;
   case GL_DRAW_INDIRECT_BUFFER:
   case GL_ARRAY_BUFFER:
   case GL_ELEMENT_ARRAY_BUFFER:
-    // Non-indexed binding targets
-    glBindBuffer(m_gleTarget, m_uiSlotIDs[m_iCurrentSlot]);
+    // Non-indexed binding targets, offsets have to add GetSlotBaseOffset()
+    glBindBuffer(m_gleTarget, m_uiBufferObject);
     break;
 
   default:
@@ -0,0 +1,169 @@
+#include "FrustumCuller.hpp"
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define EHAZ_FRUSTUM_AVX 1
+#endif
+
+#if defined(__SSE__) || defined(_M_X64) ||                                     \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define EHAZ_FRUSTUM_SSE 1
+#endif
+
+namespace eHazGraphics {
+
+void CFrustumCuller::SetViewProjection(const glm::mat4 &p_ViewProjection) {
+
+  // glm is column major, row i is m[0][i], m[1][i], m[2][i], m[3][i]
+  auto l_Row = [&](int i) {
+    return glm::vec4(p_ViewProjection[0][i], p_ViewProjection[1][i],
+                     p_ViewProjection[2][i], p_ViewProjection[3][i]);
+  };
+
+  const glm::vec4 l_X = l_Row(0);
+  const glm::vec4 l_Y = l_Row(1);
+  const glm::vec4 l_Z = l_Row(2);
+  const glm::vec4 l_W = l_Row(3);
+
+  m_Frustum.planes = {l_W + l_X, l_W - l_X, l_W + l_Y,
+                      l_W - l_Y, l_W + l_Z, l_W - l_Z};
+
+  for (glm::vec4 &plane : m_Frustum.planes) {
+    float l_fLength = glm::length(glm::vec3(plane));
+    if (l_fLength > 0.0f) {
+      plane /= l_fLength;
+    }
+  }
+
+  m_bHasFrustum = true;
+}
+
+bool CFrustumCuller::TestSphere(const glm::vec3 &p_Center, float p_fRadius) {
+  if (!IsEnabled())
+    return true;
+
+  m_Stats.tested++;
+
+  for (const glm::vec4 &plane : m_Frustum.planes) {
+    if (glm::dot(glm::vec3(plane), p_Center) + plane.w < -p_fRadius) {
+      m_Stats.culled++;
+      return false;
+    }
+  }
+
+  m_Stats.visible++;
+  return true;
+}
+
+size_t CFrustumCuller::CullSpheres(const float *p_pX, const float *p_pY,
+                                   const float *p_pZ, const float *p_pRadius,
+                                   size_t p_szCount, uint8_t *p_pVisible) {
+
+  if (!IsEnabled()) {
+    std::fill(p_pVisible, p_pVisible + p_szCount, uint8_t(1));
+    return p_szCount;
+  }
+
+  const auto &l_Planes = m_Frustum.planes;
+  size_t i = 0;
+
+#if defined(EHAZ_FRUSTUM_AVX)
+  for (; i + 8 <= p_szCount; i += 8) {
+    const __m256 l_X = _mm256_loadu_ps(p_pX + i);
+    const __m256 l_Y = _mm256_loadu_ps(p_pY + i);
+    const __m256 l_Z = _mm256_loadu_ps(p_pZ + i);
+    const __m256 l_NegRadius =
+        _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(p_pRadius + i));
+
+    __m256 l_Inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (const glm::vec4 &plane : l_Planes) {
+      __m256 l_Distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(l_X, _mm256_set1_ps(plane.x)),
+                        _mm256_mul_ps(l_Y, _mm256_set1_ps(plane.y))),
+          _mm256_add_ps(_mm256_mul_ps(l_Z, _mm256_set1_ps(plane.z)),
+                        _mm256_set1_ps(plane.w)));
+      l_Inside = _mm256_and_ps(
+          l_Inside, _mm256_cmp_ps(l_Distance, l_NegRadius, _CMP_GE_OQ));
+    }
+
+    const int l_iMask = _mm256_movemask_ps(l_Inside);
+    for (int k = 0; k < 8; k++) {
+      p_pVisible[i + k] = static_cast<uint8_t>((l_iMask >> k) & 1);
+    }
+  }
+#endif
+
+#if defined(EHAZ_FRUSTUM_SSE)
+  for (; i + 4 <= p_szCount; i += 4) {
+    const __m128 l_X = _mm_loadu_ps(p_pX + i);
+    const __m128 l_Y = _mm_loadu_ps(p_pY + i);
+    const __m128 l_Z = _mm_loadu_ps(p_pZ + i);
+    const __m128 l_NegRadius =
+        _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(p_pRadius + i));
+
+    __m128 l_Inside = _mm_cmpeq_ps(l_X, l_X); // all set unless NaN
+    for (const glm::vec4 &plane : l_Planes) {
+      __m128 l_Distance =
+          _mm_add_ps(_mm_add_ps(_mm_mul_ps(l_X, _mm_set1_ps(plane.x)),
+                                _mm_mul_ps(l_Y, _mm_set1_ps(plane.y))),
+                     _mm_add_ps(_mm_mul_ps(l_Z, _mm_set1_ps(plane.z)),
+                                _mm_set1_ps(plane.w)));
+      l_Inside = _mm_and_ps(l_Inside, _mm_cmpge_ps(l_Distance, l_NegRadius));
+    }
+
+    const int l_iMask = _mm_movemask_ps(l_Inside);
+    for (int k = 0; k < 4; k++) {
+      p_pVisible[i + k] = static_cast<uint8_t>((l_iMask >> k) & 1);
+    }
+  }
+#endif
+
+  for (; i < p_szCount; i++) {
+    bool l_bInside = true;
+    for (const glm::vec4 &plane : l_Planes) {
+      float l_fDistance = plane.x * p_pX[i] + plane.y * p_pY[i] +
+                          plane.z * p_pZ[i] + plane.w;
+      l_bInside &= l_fDistance >= -p_pRadius[i];
+    }
+    p_pVisible[i] = static_cast<uint8_t>(l_bInside);
+  }
+
+  size_t l_szVisible = 0;
+  for (size_t k = 0; k < p_szCount; k++) {
+    l_szVisible += p_pVisible[k];
+  }
+
+  m_Stats.tested += static_cast<uint32_t>(p_szCount);
+  m_Stats.visible += static_cast<uint32_t>(l_szVisible);
+  m_Stats.culled += static_cast<uint32_t>(p_szCount - l_szVisible);
+
+  return l_szVisible;
+}
+
+void CFrustumCuller::EndFrame() {
+  m_LastStats = m_Stats;
+  m_Stats = SCullStats();
+}
+
+void TransformBoundingSphere(const SBounds &p_Bounds, const glm::mat4 &p_World,
+                             glm::vec3 &p_Center, float &p_fRadius) {
+
+  p_Center = glm::vec3(p_World[3]);
+
+  if (!p_Bounds.IsValid()) {
+    p_fRadius = std::numeric_limits<float>::infinity();
+    return;
+  }
+
+  p_Center = glm::vec3(p_World * glm::vec4(p_Bounds.center, 1.0f));
+
+  const float l_fScale = std::max({glm::length(glm::vec3(p_World[0])),
+                                   glm::length(glm::vec3(p_World[1])),
+                                   glm::length(glm::vec3(p_World[2]))});
+  p_fRadius = p_Bounds.radius * l_fScale;
+}
+
+} // namespace eHazGraphics
@@ -0,0 +1,246 @@
+#include "GPUCuller.hpp"
+#include "ShaderManager.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <string>
+
+namespace eHazGraphics {
+
+// SSBO bindings above the ones the render shaders use
+static constexpr GLuint CULL_INPUT_BINDING = 16;
+static constexpr GLuint CULL_BOUNDS_BINDING = 17;
+static constexpr GLuint CULL_RANGES_BINDING = 18;
+static constexpr GLuint CULL_OUTPUT_BINDING = 19;
+static constexpr GLuint CULL_COUNTS_BINDING = 20;
+
+static constexpr GLuint CULL_GROUP_SIZE = 64;
+
+static const char *CULL_COMPUTE_SOURCE = R"(#version 460 core
+layout(local_size_x = 64) in;
+
+struct DrawCommand {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    uint baseVertex;
+    uint baseInstance;
+};
+
+struct InstanceData {
+    mat4 model;
+    uint materialID;
+    uint modelMatID;
+    uint numJoints;
+    uint animMatLocation;
+};
+
+layout(binding = 0, std430) readonly buffer ssbo0 {
+    InstanceData instances[];
+};
+
+layout(binding = 16, std430) readonly buffer CullInput {
+    DrawCommand inCommands[];
+};
+
+layout(binding = 17, std430) readonly buffer CullBounds {
+    vec4 bounds[];
+};
+
+layout(binding = 18, std430) readonly buffer CullRanges {
+    uvec2 commandRanges[];
+};
+
+layout(binding = 19, std430) writeonly buffer CullOutput {
+    DrawCommand outCommands[];
+};
+
+layout(binding = 20, std430) buffer CullCounts {
+    uint drawCounts[];
+};
+
+uniform vec4 u_Planes[6];
+uniform uint u_CommandCount;
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= u_CommandCount)
+        return;
+
+    DrawCommand command = inCommands[id];
+    vec4 sphere = bounds[id];
+
+    if (sphere.w >= 0.0) {
+        mat4 world = instances[command.baseInstance].model;
+        vec3 center = (world * vec4(sphere.xyz, 1.0)).xyz;
+        float scale = max(length(world[0].xyz),
+                          max(length(world[1].xyz), length(world[2].xyz)));
+        float radius = sphere.w * scale;
+
+        for (int i = 0; i < 6; i++) {
+            if (dot(u_Planes[i].xyz, center) + u_Planes[i].w < -radius)
+                return;
+        }
+    }
+
+    uvec2 range = commandRanges[id];
+    uint slot = atomicAdd(drawCounts[range.x], 1u);
+    outCommands[range.y + slot] = command;
+}
+)";
+
+bool CGPUCuller::Initialize() {
+  if (IsInitialized())
+    return true;
+
+  Shader l_Compute(CULL_COMPUTE_SOURCE, ShaderSpec{false, ".comp"});
+  GLuint l_uiShader = l_Compute.GetGLShaderID();
+
+  GLint l_iCompiled = 0;
+  glGetShaderiv(l_uiShader, GL_COMPILE_STATUS, &l_iCompiled);
+  if (!l_iCompiled)
+    return false;
+
+  m_uiProgram = glCreateProgram();
+  glAttachShader(m_uiProgram, l_uiShader);
+  glLinkProgram(m_uiProgram);
+  glDetachShader(m_uiProgram, l_uiShader);
+
+  GLint l_iLinked = 0;
+  glGetProgramiv(m_uiProgram, GL_LINK_STATUS, &l_iLinked);
+  if (!l_iLinked) {
+    char l_InfoLog[512];
+    glGetProgramInfoLog(m_uiProgram, 512, NULL, l_InfoLog);
+
+    std::string l_Error("ERROR::GPU_CULLER::PROGRAMME::LINK_FAILED\n");
+    l_Error += l_InfoLog;
+    SDL_Log("%s", l_Error.c_str());
+
+    glDeleteProgram(m_uiProgram);
+    m_uiProgram = 0;
+    return false;
+  }
+
+  m_iPlanesLocation = glGetUniformLocation(m_uiProgram, "u_Planes");
+  m_iCommandCountLocation = glGetUniformLocation(m_uiProgram, "u_CommandCount");
+
+  return true;
+}
+
+void CGPUCuller::Destroy() {
+  if (m_uiProgram != 0) {
+    glDeleteProgram(m_uiProgram);
+    m_uiProgram = 0;
+  }
+
+  for (GLuint *buffer : {&m_uiInputCommands, &m_uiBounds, &m_uiCommandRanges,
+                         &m_uiOutputCommands, &m_uiDrawCounts}) {
+    if (*buffer != 0) {
+      glDeleteBuffers(1, buffer);
+      *buffer = 0;
+    }
+  }
+
+  m_szInputCapacity = m_szBoundsCapacity = m_szRangesCapacity = 0;
+  m_szOutputCapacity = m_szCountsCapacity = 0;
+  m_uiCommandCount = m_uiRangeCount = 0;
+}
+
+void CGPUCuller::Reserve(GLuint &p_Buffer, size_t &p_szCapacity,
+                         size_t p_szSize) {
+  if (p_szSize <= p_szCapacity && p_Buffer != 0)
+    return;
+
+  if (p_Buffer != 0) {
+    glDeleteBuffers(1, &p_Buffer);
+  }
+
+  p_szCapacity = std::max(p_szSize, p_szCapacity * 2);
+  glCreateBuffers(1, &p_Buffer);
+  glNamedBufferStorage(p_Buffer, p_szCapacity, nullptr,
+                       GL_DYNAMIC_STORAGE_BIT);
+}
+
+void CGPUCuller::SetCommands(
+    std::span<const DrawElementsIndirectCommand> p_Commands,
+    std::span<const glm::vec4> p_Bounds,
+    std::span<const glm::uvec2> p_CommandRanges, uint32_t p_uiRangeCount) {
+
+  if (p_Bounds.size() != p_Commands.size() ||
+      p_CommandRanges.size() != p_Commands.size()) {
+    SDL_Log("CGPUCuller::SetCommands: bounds and ranges do not match the "
+            "commands");
+    m_uiCommandCount = m_uiRangeCount = 0;
+    return;
+  }
+
+  m_uiCommandCount = static_cast<uint32_t>(p_Commands.size());
+  m_uiRangeCount = p_uiRangeCount;
+
+  if (m_uiCommandCount == 0)
+    return;
+
+  Reserve(m_uiInputCommands, m_szInputCapacity, p_Commands.size_bytes());
+  Reserve(m_uiBounds, m_szBoundsCapacity, p_Bounds.size_bytes());
+  Reserve(m_uiCommandRanges, m_szRangesCapacity, p_CommandRanges.size_bytes());
+  Reserve(m_uiOutputCommands, m_szOutputCapacity, p_Commands.size_bytes());
+  Reserve(m_uiDrawCounts, m_szCountsCapacity,
+          std::max<size_t>(m_uiRangeCount, 1) * sizeof(GLuint));
+
+  glNamedBufferSubData(m_uiInputCommands, 0, p_Commands.size_bytes(),
+                       p_Commands.data());
+  glNamedBufferSubData(m_uiBounds, 0, p_Bounds.size_bytes(), p_Bounds.data());
+  glNamedBufferSubData(m_uiCommandRanges, 0, p_CommandRanges.size_bytes(),
+                       p_CommandRanges.data());
+}
+
+void CGPUCuller::Dispatch(const SFrustum &p_Frustum) {
+  if (!IsInitialized() || m_uiCommandCount == 0)
+    return;
+
+  const GLuint l_uiZero = 0;
+  glClearNamedBufferSubData(m_uiDrawCounts, GL_R32UI, 0,
+                            m_uiRangeCount * sizeof(GLuint), GL_RED_INTEGER,
+                            GL_UNSIGNED_INT, &l_uiZero);
+
+  glUseProgram(m_uiProgram);
+  glUniform4fv(m_iPlanesLocation, 6, &p_Frustum.planes[0].x);
+  glUniform1ui(m_iCommandCountLocation, m_uiCommandCount);
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_INPUT_BINDING,
+                   m_uiInputCommands);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_BOUNDS_BINDING, m_uiBounds);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_RANGES_BINDING,
+                   m_uiCommandRanges);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_OUTPUT_BINDING,
+                   m_uiOutputCommands);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CULL_COUNTS_BINDING,
+                   m_uiDrawCounts);
+
+  glDispatchCompute((m_uiCommandCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE,
+                    1, 1);
+
+  // the draws read the commands and counts as indirect parameters
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+void CGPUCuller::BindForDrawing() const {
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_uiOutputCommands);
+  glBindBuffer(GL_PARAMETER_BUFFER, m_uiDrawCounts);
+}
+
+void CGPUCuller::DrawCulledRange(uint32_t p_uiRange,
+                                 const DrawRange &p_Range) const {
+  if (p_uiRange >= m_uiRangeCount)
+    return;
+
+  const GLintptr l_Offset =
+      p_Range.startIndex * sizeof(DrawElementsIndirectCommand);
+
+  glMultiDrawElementsIndirectCount(
+      GL_TRIANGLES, p_Range.indexType, (void *)l_Offset,
+      static_cast<GLintptr>(p_uiRange * sizeof(GLuint)),
+      static_cast<GLsizei>(p_Range.count), 0);
+}
+
+} // namespace eHazGraphics
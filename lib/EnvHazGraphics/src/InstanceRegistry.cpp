@@ -0,0 +1,202 @@
+#include "InstanceRegistry.hpp"
+#include "BitFlags.hpp"
+#include "DataStructs.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+
+namespace eHazGraphics {
+
+CInstanceRegistry::CInstanceRegistry() {}
+
+CInstanceRegistry::CInstanceRegistry(CDynamicBuffer *p_pInstanceBuffer,
+                                     uint32_t p_uiInitialCapacity)
+    : m_pInstanceBuffer(p_pInstanceBuffer) {
+
+  m_uiAllSlotsMask =
+      static_cast<uint8_t>((1u << m_pInstanceBuffer->GetSlotCount()) - 1u);
+
+  if (m_pInstanceBuffer->ReservePersistentRegion(p_uiInitialCapacity *
+                                                 sizeof(InstanceData))) {
+    m_uiCapacity = p_uiInitialCapacity;
+  }
+}
+
+SInstanceHandle CInstanceRegistry::Register(const InstanceData &p_Data) {
+
+  uint32_t l_uiIndex;
+
+  if (!m_FreeIndices.empty()) {
+    l_uiIndex = m_FreeIndices.back();
+    m_FreeIndices.pop_back();
+    m_Instances[l_uiIndex] = p_Data;
+  } else {
+    l_uiIndex = static_cast<uint32_t>(m_Instances.size());
+    m_Instances.push_back(p_Data);
+    m_Generations.push_back(0);
+    m_DirtySlots.push_back(0);
+    m_Alive.push_back(false);
+  }
+
+  m_Generations[l_uiIndex]++;
+  m_Alive[l_uiIndex] = true;
+  m_uiLiveCount++;
+
+  MarkDirty(l_uiIndex);
+
+  if (l_uiIndex < m_uiCapacity) {
+    WriteToWriteSlot(l_uiIndex);
+  } else {
+    m_FallbackRanges[l_uiIndex] = m_pInstanceBuffer->InsertNewData(
+        &m_Instances[l_uiIndex], sizeof(InstanceData),
+        TypeFlags::BUFFER_INSTANCE_DATA);
+  }
+
+  SInstanceHandle l_Handle;
+  l_Handle.index = l_uiIndex;
+  l_Handle.generation = m_Generations[l_uiIndex];
+  return l_Handle;
+}
+
+void CInstanceRegistry::Update(const SInstanceHandle &p_Handle,
+                               const InstanceData &p_Data) {
+  if (!IsValid(p_Handle)) {
+    SDL_Log("CInstanceRegistry::Update: stale instance handle %u",
+            p_Handle.index);
+    return;
+  }
+
+  m_Instances[p_Handle.index] = p_Data;
+  MarkDirty(p_Handle.index);
+
+  if (p_Handle.index < m_uiCapacity) {
+    WriteToWriteSlot(p_Handle.index);
+  } else {
+    m_FallbackRanges[p_Handle.index] = m_pInstanceBuffer->InsertNewData(
+        &m_Instances[p_Handle.index], sizeof(InstanceData),
+        TypeFlags::BUFFER_INSTANCE_DATA);
+  }
+}
+
+void CInstanceRegistry::SetTransform(const SInstanceHandle &p_Handle,
+                                     const glm::mat4 &p_Transform) {
+  if (!IsValid(p_Handle))
+    return;
+
+  InstanceData l_Data = m_Instances[p_Handle.index];
+  l_Data.worldMat = p_Transform;
+  Update(p_Handle, l_Data);
+}
+
+void CInstanceRegistry::Release(const SInstanceHandle &p_Handle) {
+  if (!IsValid(p_Handle))
+    return;
+
+  m_Alive[p_Handle.index] = false;
+  m_Generations[p_Handle.index]++;
+  m_FallbackRanges.erase(p_Handle.index);
+  m_FreeIndices.push_back(p_Handle.index);
+  m_uiLiveCount--;
+}
+
+bool CInstanceRegistry::IsValid(const SInstanceHandle &p_Handle) const {
+  if (p_Handle.index >= m_Instances.size())
+    return false;
+
+  return m_Alive[p_Handle.index] &&
+         m_Generations[p_Handle.index] == p_Handle.generation;
+}
+
+std::optional<InstanceData>
+CInstanceRegistry::Get(const SInstanceHandle &p_Handle) const {
+  if (!IsValid(p_Handle))
+    return std::nullopt;
+
+  return m_Instances[p_Handle.index];
+}
+
+uint32_t CInstanceRegistry::GetGPUIndex(const SInstanceHandle &p_Handle) {
+
+  auto it = m_FallbackRanges.find(p_Handle.index);
+  if (it != m_FallbackRanges.end()) {
+    auto l_Allocation =
+        m_pInstanceBuffer->GetAllocation(it->second.handle.allocationID);
+    if (l_Allocation)
+      return static_cast<uint32_t>(l_Allocation->offset /
+                                   sizeof(InstanceData));
+  }
+
+  return p_Handle.index;
+}
+
+void CInstanceRegistry::Flush() {
+
+  // transient copies died with the ClearBuffer() that preceded this call
+  m_FallbackRanges.clear();
+
+  if (m_Instances.size() > m_uiCapacity) {
+    uint32_t l_uiNewCapacity = std::max<uint32_t>(
+        m_uiCapacity * 2, static_cast<uint32_t>(m_Instances.size()));
+
+    if (m_pInstanceBuffer->ReservePersistentRegion(l_uiNewCapacity *
+                                                   sizeof(InstanceData))) {
+      m_uiCapacity = l_uiNewCapacity;
+    }
+  }
+
+  const uint8_t l_uiSlotBit = GetWriteSlotBit();
+
+  size_t l_szKept = 0;
+  for (size_t i = 0; i < m_DirtyIndices.size(); i++) {
+    uint32_t l_uiIndex = m_DirtyIndices[i];
+
+    if (!m_Alive[l_uiIndex]) {
+      m_DirtySlots[l_uiIndex] = 0;
+      continue;
+    }
+
+    if ((m_DirtySlots[l_uiIndex] & l_uiSlotBit) != 0) {
+      if (l_uiIndex < m_uiCapacity) {
+        WriteToWriteSlot(l_uiIndex);
+      } else {
+        m_FallbackRanges[l_uiIndex] = m_pInstanceBuffer->InsertNewData(
+            &m_Instances[l_uiIndex], sizeof(InstanceData),
+            TypeFlags::BUFFER_INSTANCE_DATA);
+      }
+    }
+
+    if (m_DirtySlots[l_uiIndex] != 0)
+      m_DirtyIndices[l_szKept++] = l_uiIndex;
+  }
+  m_DirtyIndices.resize(l_szKept);
+}
+
+void CInstanceRegistry::Clear() {
+  m_Instances.clear();
+  m_Generations.clear();
+  m_DirtySlots.clear();
+  m_Alive.clear();
+  m_FreeIndices.clear();
+  m_DirtyIndices.clear();
+  m_FallbackRanges.clear();
+  m_uiLiveCount = 0;
+}
+
+void CInstanceRegistry::MarkDirty(uint32_t p_uiIndex) {
+  if (m_DirtySlots[p_uiIndex] == 0)
+    m_DirtyIndices.push_back(p_uiIndex);
+
+  m_DirtySlots[p_uiIndex] = m_uiAllSlotsMask;
+}
+
+void CInstanceRegistry::WriteToWriteSlot(uint32_t p_uiIndex) {
+  m_pInstanceBuffer->WriteRange(p_uiIndex * sizeof(InstanceData),
+                                &m_Instances[p_uiIndex], sizeof(InstanceData));
+
+  m_DirtySlots[p_uiIndex] &= static_cast<uint8_t>(~GetWriteSlotBit());
+}
+
+uint8_t CInstanceRegistry::GetWriteSlotBit() const {
+  return static_cast<uint8_t>(1u << m_pInstanceBuffer->GetWriteSlot());
+}
+
+} // namespace eHazGraphics
@@ -18,6 +18,7 @@ void MaterialManager::ClearMaterials() {
   freeIndecies.clear();
   TexturePaths.clear();
   MaterialNames.clear();
+  m_szTextureBytes = 0;
 }
 
 unsigned int MaterialManager::LoadTexture(const std::string &path) {
@@ -32,6 +33,7 @@ unsigned int MaterialManager::LoadTexture(const std::string &path) {
   LoadedTextures.push_back(std::make_unique<Texture2D>(path));
   unsigned int id = LoadedTextures.size() - 1;
   LoadedTextures[id]->MakeResident();
+  m_szTextureBytes += LoadedTextures[id]->GetMemorySize();
   TexturePaths.emplace(h_path, id);
 
   return id;
@@ -0,0 +1,68 @@
+#include "MemoryBudget.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+
+namespace eHazGraphics {
+
+size_t SMemoryReport::GetBufferBytes() const {
+  size_t l_szBytes = 0;
+  for (const SBufferMemoryStats &buffer : buffers) {
+    l_szBytes += buffer.capacityBytes;
+  }
+  return l_szBytes;
+}
+
+size_t SMemoryReport::GetWastedBytes() const {
+  size_t l_szBytes = 0;
+  for (const SBufferMemoryStats &buffer : buffers) {
+    l_szBytes += buffer.wastedBytes;
+  }
+  return l_szBytes;
+}
+
+uint32_t CMemoryBudget::AddEvictionCallback(EvictionCallback p_Callback) {
+  uint32_t l_uiID = m_uiNextCallbackID++;
+  m_Callbacks.push_back(SCallbackEntry{l_uiID, std::move(p_Callback)});
+  return l_uiID;
+}
+
+void CMemoryBudget::RemoveEvictionCallback(uint32_t p_uiCallbackID) {
+  std::erase_if(m_Callbacks, [p_uiCallbackID](const SCallbackEntry &entry) {
+    return entry.id == p_uiCallbackID;
+  });
+}
+
+bool CMemoryBudget::Evaluate(const SMemoryReport &p_Report) {
+
+  if (m_szBudget == 0)
+    return true;
+
+  const size_t l_szTotal = p_Report.GetTotalBytes();
+
+  if (l_szTotal <= m_szBudget) {
+    m_bWasOverBudget = false;
+    return true;
+  }
+
+  m_uiOverBudgetFrames++;
+
+  size_t l_szOver = l_szTotal - m_szBudget;
+
+  if (!m_bWasOverBudget) {
+    SDL_Log("CMemoryBudget: %zu bytes in use, %zu over the budget of %zu",
+            l_szTotal, l_szOver, m_szBudget);
+    m_bWasOverBudget = true;
+  }
+
+  for (SCallbackEntry &entry : m_Callbacks) {
+    size_t l_szReleased = entry.callback(p_Report, l_szOver);
+    l_szOver -= std::min(l_szOver, l_szReleased);
+
+    if (l_szOver == 0)
+      break;
+  }
+
+  return false;
+}
+
+} // namespace eHazGraphics
@@ -24,11 +24,17 @@ void MeshManager::EraseMesh(MeshID mesh) {
 
   bufferManager->InvalidateStaticRange(meshLoc);
 
-  //bufferManager->RemoveRange(meshTransformRanges[mesh]);
+  if (auto it = lodLocations.find(mesh); it != lodLocations.end()) {
+    for (auto &location : it->second) {
+      bufferManager->InvalidateStaticRange(location);
+    }
+    lodLocations.erase(it);
+  }
+
+  bufferManager->GetStaticMatrixPool().Remove(mesh);
 
   meshes.erase(mesh);
   meshTransforms.erase(mesh);
-  meshTransformRanges.erase(mesh);
   meshLocations.erase(mesh);
 }
 
@@ -57,6 +63,7 @@ std::shared_ptr<Model> MeshManager::LoadModel(std::string &path) {
 
   const aiScene *scene = importer.ReadFile(
       path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenNormals |
+                aiProcess_JoinIdenticalVertices |
                 /*aiProcess_PreTransformVertices |*/ aiProcess_OptimizeMeshes);
 
   if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE ||
@@ -65,7 +72,9 @@ std::shared_ptr<Model> MeshManager::LoadModel(std::string &path) {
     SDL_Log("ERROR LOADING THE MODEL: %s", importer.GetErrorString());
   }
 
+  lastOptimizeStats = SMeshOptimizeStats();
   temps = (processNode(scene->mRootNode, scene));
+  lastOptimizeStats.Log(path.c_str());
 
   // Model model;
   std::shared_ptr<Model> model = std::make_shared<Model>();
@@ -100,9 +109,8 @@ std::vector<MeshID> MeshManager::processNode(aiNode *node,
     meshes[t_hsID].setRelativeMatrix(relativeMat);
     meshes[t_hsID].SetID(t_hsID);
 
-   // AddTransformRange(t_hsID, bufferManager->InsertNewDynamicData(
-   //                               &relativeMat, sizeof(relativeMat),
-   //                              TypeFlags::BUFFER_STATIC_MATRIX_DATA));
+    bufferManager->GetStaticMatrixPool().SetMatrix(t_hsID,
+                                                   meshTransforms[t_hsID]);
 
     meshIDs.push_back(t_hsID);
   }
@@ -160,14 +168,35 @@ Mesh MeshManager::processMesh(aiMesh *mesh, const aiScene *scene) {
       indices.push_back(face.mIndices[j]);
   }
 
+  MeshData data{vertices, indices};
+  lastOptimizeStats.Add(OptimizeMesh(data, meshOptimizeSettings));
+  ComputeMeshBounds(data);
+
   // material stuff here
   //
   //
-  return Mesh({vertices, indices}, ShaderComboID());
+  Mesh finalMesh = Mesh(data, ShaderComboID());
+  finalMesh.SetLODs(GenerateMeshLODs(data, lodSettings, meshOptimizeSettings));
+  finalMesh.SetMeshlets(
+      BuildMeshlets(finalMesh.GetMeshData(), meshletSettings));
+
+  return finalMesh;
 }
 
 void MeshManager::Initialize(BufferManager *bufferManager) {
   this->bufferManager = bufferManager;
+
+  bufferManager->AddStaticRemapListener(
+      [this](const SStaticRemapTable &remap) {
+        for (auto &[id, location] : meshLocations) {
+          remap.Apply(location);
+        }
+        for (auto &[id, locations] : lodLocations) {
+          for (auto &location : locations) {
+            remap.Apply(location);
+          }
+        }
+      });
 }
 
 void MeshManager::Destroy() {}
@@ -0,0 +1,396 @@
+#include "MeshOptimizer.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace eHazGraphics {
+
+// Forsyth's scoring, the cache it models is independent of the FIFO size the
+// statistics simulate
+static constexpr int FORSYTH_CACHE_SIZE = 32;
+static constexpr float CACHE_DECAY_POWER = 1.5f;
+static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+static constexpr uint32_t NO_TRIANGLE = static_cast<uint32_t>(-1);
+
+void SMeshOptimizeStats::Add(const SMeshOptimizeStats &p_Other) {
+  meshes += p_Other.meshes;
+  triangles += p_Other.triangles;
+  verticesBefore += p_Other.verticesBefore;
+  verticesAfter += p_Other.verticesAfter;
+  cacheMissesBefore += p_Other.cacheMissesBefore;
+  cacheMissesAfter += p_Other.cacheMissesAfter;
+}
+
+void SMeshOptimizeStats::Log(const char *p_sName) const {
+  SDL_Log("Mesh optimization %s: %llu meshes, %llu triangles, ACMR %.3f -> "
+          "%.3f, ATVR %.3f -> %.3f",
+          p_sName, static_cast<unsigned long long>(meshes),
+          static_cast<unsigned long long>(triangles), GetACMRBefore(),
+          GetACMRAfter(), GetATVRBefore(), GetATVRAfter());
+}
+
+uint64_t SimulateVertexCache(const std::vector<GLuint> &p_Indices,
+                             size_t p_szVertexCount, uint32_t p_uiCacheSize) {
+
+  // a vertex is still cached while fewer than p_uiCacheSize misses happened
+  // since it was last loaded
+  std::vector<uint64_t> l_LoadTime(p_szVertexCount, 0);
+  uint64_t l_uiMisses = 0;
+  uint64_t l_uiTime = p_uiCacheSize + 1;
+
+  for (GLuint index : p_Indices) {
+    if (l_uiTime - l_LoadTime[index] > p_uiCacheSize) {
+      l_LoadTime[index] = l_uiTime++;
+      l_uiMisses++;
+    }
+  }
+
+  return l_uiMisses;
+}
+
+static float VertexScore(int p_iCachePosition, uint32_t p_uiRemaining) {
+  if (p_uiRemaining == 0)
+    return -1.0f;
+
+  float l_fScore = 0.0f;
+
+  if (p_iCachePosition >= 0) {
+    if (p_iCachePosition < 3) {
+      // the triangle just drawn, deliberately not the best so strips do not
+      // go back and forth
+      l_fScore = LAST_TRIANGLE_SCORE;
+    } else {
+      const float l_fScale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+      l_fScore = std::pow(1.0f - (p_iCachePosition - 3) * l_fScale,
+                          CACHE_DECAY_POWER);
+    }
+  }
+
+  // vertices with few triangles left get finished first
+  l_fScore += VALENCE_BOOST_SCALE *
+              std::pow(static_cast<float>(p_uiRemaining), -VALENCE_BOOST_POWER);
+  return l_fScore;
+}
+
+void OptimizeVertexCache(std::vector<GLuint> &p_Indices,
+                         size_t p_szVertexCount) {
+
+  const size_t l_szTriangleCount = p_Indices.size() / 3;
+  if (l_szTriangleCount < 2)
+    return;
+
+  // triangles of each vertex, packed as [offsets[v], offsets[v] + remaining)
+  std::vector<uint32_t> l_Offsets(p_szVertexCount + 1, 0);
+  for (GLuint index : p_Indices) {
+    l_Offsets[index + 1]++;
+  }
+  std::partial_sum(l_Offsets.begin(), l_Offsets.end(), l_Offsets.begin());
+
+  std::vector<uint32_t> l_Remaining(p_szVertexCount);
+  std::vector<uint32_t> l_Adjacency(p_Indices.size());
+
+  for (size_t t = 0; t < l_szTriangleCount; t++) {
+    for (size_t k = 0; k < 3; k++) {
+      GLuint v = p_Indices[t * 3 + k];
+      l_Adjacency[l_Offsets[v] + l_Remaining[v]++] = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<int> l_CachePosition(p_szVertexCount, -1);
+  std::vector<float> l_VertexScores(p_szVertexCount);
+  for (size_t v = 0; v < p_szVertexCount; v++) {
+    l_VertexScores[v] = VertexScore(-1, l_Remaining[v]);
+  }
+
+  std::vector<float> l_TriangleScores(l_szTriangleCount);
+  std::vector<bool> l_Emitted(l_szTriangleCount, false);
+
+  uint32_t l_uiBest = NO_TRIANGLE;
+  float l_fBestScore = -1.0f;
+
+  for (size_t t = 0; t < l_szTriangleCount; t++) {
+    l_TriangleScores[t] = l_VertexScores[p_Indices[t * 3]] +
+                          l_VertexScores[p_Indices[t * 3 + 1]] +
+                          l_VertexScores[p_Indices[t * 3 + 2]];
+    if (l_TriangleScores[t] > l_fBestScore) {
+      l_fBestScore = l_TriangleScores[t];
+      l_uiBest = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<GLuint> l_Result;
+  l_Result.reserve(p_Indices.size());
+
+  std::vector<GLuint> l_Cache;
+  std::vector<GLuint> l_NewCache;
+  l_Cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  l_NewCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  size_t l_szScanCursor = 0;
+
+  while (l_Result.size() < p_Indices.size()) {
+
+    if (l_uiBest == NO_TRIANGLE) {
+      // nothing next to the cache is left, restart at the first triangle
+      // that was not drawn yet
+      while (l_Emitted[l_szScanCursor]) {
+        l_szScanCursor++;
+      }
+      l_uiBest = static_cast<uint32_t>(l_szScanCursor);
+    }
+
+    const GLuint *l_pTriangle = &p_Indices[l_uiBest * 3];
+    l_Emitted[l_uiBest] = true;
+    l_Result.insert(l_Result.end(), l_pTriangle, l_pTriangle + 3);
+
+    l_NewCache.clear();
+
+    for (size_t k = 0; k < 3; k++) {
+      GLuint v = l_pTriangle[k];
+
+      uint32_t *l_pBegin = &l_Adjacency[l_Offsets[v]];
+      uint32_t *l_pEnd = l_pBegin + l_Remaining[v];
+      uint32_t *l_pFound = std::find(l_pBegin, l_pEnd, l_uiBest);
+      if (l_pFound != l_pEnd) {
+        *l_pFound = *(l_pEnd - 1);
+        l_Remaining[v]--;
+      }
+
+      if (std::find(l_NewCache.begin(), l_NewCache.end(), v) ==
+          l_NewCache.end()) {
+        l_NewCache.push_back(v);
+      }
+    }
+
+    for (GLuint v : l_Cache) {
+      if (std::find(l_NewCache.begin(), l_NewCache.end(), v) ==
+          l_NewCache.end()) {
+        l_NewCache.push_back(v);
+      }
+    }
+
+    // everything past the cache size was pushed out, it is rescored below
+    // with position -1 and then dropped
+    for (size_t i = 0; i < l_NewCache.size(); i++) {
+      l_CachePosition[l_NewCache[i]] =
+          i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+      l_VertexScores[l_NewCache[i]] =
+          VertexScore(l_CachePosition[l_NewCache[i]], l_Remaining[l_NewCache[i]]);
+    }
+
+    l_uiBest = NO_TRIANGLE;
+    l_fBestScore = -1.0f;
+
+    for (GLuint v : l_NewCache) {
+      for (uint32_t a = 0; a < l_Remaining[v]; a++) {
+        uint32_t t = l_Adjacency[l_Offsets[v] + a];
+
+        l_TriangleScores[t] = l_VertexScores[p_Indices[t * 3]] +
+                              l_VertexScores[p_Indices[t * 3 + 1]] +
+                              l_VertexScores[p_Indices[t * 3 + 2]];
+
+        if (l_TriangleScores[t] > l_fBestScore) {
+          l_fBestScore = l_TriangleScores[t];
+          l_uiBest = t;
+        }
+      }
+    }
+
+    if (l_NewCache.size() > FORSYTH_CACHE_SIZE) {
+      l_NewCache.resize(FORSYTH_CACHE_SIZE);
+    }
+    l_Cache.swap(l_NewCache);
+  }
+
+  p_Indices.swap(l_Result);
+}
+
+void OptimizeOverdraw(std::vector<GLuint> &p_Indices,
+                      const std::vector<Vertex> &p_Vertices,
+                      uint32_t p_uiCacheSize) {
+
+  const size_t l_szTriangleCount = p_Indices.size() / 3;
+  if (l_szTriangleCount < 2)
+    return;
+
+  // a cluster starts wherever all three vertices of a triangle miss the
+  // cache, moving whole clusters around then costs next to no cache hits
+  std::vector<size_t> l_ClusterStarts;
+  std::vector<uint64_t> l_LoadTime(p_Vertices.size(), 0);
+  uint64_t l_uiTime = p_uiCacheSize + 1;
+
+  for (size_t t = 0; t < l_szTriangleCount; t++) {
+    int l_iMisses = 0;
+    for (size_t k = 0; k < 3; k++) {
+      GLuint v = p_Indices[t * 3 + k];
+      if (l_uiTime - l_LoadTime[v] > p_uiCacheSize) {
+        l_LoadTime[v] = l_uiTime++;
+        l_iMisses++;
+      }
+    }
+    if (t == 0 || l_iMisses == 3) {
+      l_ClusterStarts.push_back(t);
+    }
+  }
+
+  if (l_ClusterStarts.size() < 2)
+    return;
+
+  glm::vec3 l_MeshCentre(0.0f);
+  for (const Vertex &vertex : p_Vertices) {
+    l_MeshCentre += vertex.Position;
+  }
+  l_MeshCentre /= static_cast<float>(p_Vertices.size());
+
+  struct SCluster {
+    size_t first = 0; // triangle
+    size_t count = 0;
+    float sortKey = 0.0f;
+  };
+
+  std::vector<SCluster> l_Clusters(l_ClusterStarts.size());
+
+  for (size_t c = 0; c < l_ClusterStarts.size(); c++) {
+    SCluster &cluster = l_Clusters[c];
+    cluster.first = l_ClusterStarts[c];
+    cluster.count = (c + 1 < l_ClusterStarts.size() ? l_ClusterStarts[c + 1]
+                                                    : l_szTriangleCount) -
+                    cluster.first;
+
+    // area weighted centroid and normal
+    glm::vec3 l_Centroid(0.0f);
+    glm::vec3 l_Normal(0.0f);
+    float l_fArea = 0.0f;
+
+    for (size_t t = cluster.first; t < cluster.first + cluster.count; t++) {
+      const glm::vec3 &a = p_Vertices[p_Indices[t * 3]].Position;
+      const glm::vec3 &b = p_Vertices[p_Indices[t * 3 + 1]].Position;
+      const glm::vec3 &c3 = p_Vertices[p_Indices[t * 3 + 2]].Position;
+
+      glm::vec3 l_Cross = glm::cross(b - a, c3 - a);
+      float l_fTriangleArea = glm::length(l_Cross);
+
+      l_Centroid += (a + b + c3) * (l_fTriangleArea / 3.0f);
+      l_Normal += l_Cross;
+      l_fArea += l_fTriangleArea;
+    }
+
+    if (l_fArea > 0.0f) {
+      l_Centroid /= l_fArea;
+    }
+    float l_fNormalLength = glm::length(l_Normal);
+    if (l_fNormalLength > 0.0f) {
+      l_Normal /= l_fNormalLength;
+    }
+
+    cluster.sortKey = glm::dot(l_Centroid - l_MeshCentre, l_Normal);
+  }
+
+  std::stable_sort(l_Clusters.begin(), l_Clusters.end(),
+                   [](const SCluster &a, const SCluster &b) {
+                     return a.sortKey > b.sortKey;
+                   });
+
+  std::vector<GLuint> l_Result;
+  l_Result.reserve(p_Indices.size());
+  for (const SCluster &cluster : l_Clusters) {
+    l_Result.insert(l_Result.end(), p_Indices.begin() + cluster.first * 3,
+                    p_Indices.begin() + (cluster.first + cluster.count) * 3);
+  }
+
+  p_Indices.swap(l_Result);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex> &p_Vertices,
+                         std::vector<GLuint> &p_Indices) {
+
+  std::vector<GLuint> l_Remap(p_Vertices.size(), INVALID_ALLOCATION);
+  std::vector<Vertex> l_Result;
+  l_Result.reserve(p_Vertices.size());
+
+  for (GLuint &index : p_Indices) {
+    if (l_Remap[index] == INVALID_ALLOCATION) {
+      l_Remap[index] = static_cast<GLuint>(l_Result.size());
+      l_Result.push_back(p_Vertices[index]);
+    }
+    index = l_Remap[index];
+  }
+
+  p_Vertices.swap(l_Result);
+}
+
+void ComputeMeshBounds(MeshData &p_Mesh) {
+  const std::vector<Vertex> &l_Vertices = p_Mesh.vertices;
+
+  p_Mesh.bounds = SBounds();
+  if (l_Vertices.empty())
+    return;
+
+  glm::vec3 l_Min = l_Vertices[0].Position;
+  glm::vec3 l_Max = l_Min;
+  for (const Vertex &vertex : l_Vertices) {
+    l_Min = glm::min(l_Min, vertex.Position);
+    l_Max = glm::max(l_Max, vertex.Position);
+  }
+
+  p_Mesh.bounds.min = l_Min;
+  p_Mesh.bounds.max = l_Max;
+  p_Mesh.bounds.center = (l_Min + l_Max) * 0.5f;
+
+  float l_fRadius = 0.0f;
+  for (const Vertex &vertex : l_Vertices) {
+    l_fRadius = std::max(
+        l_fRadius, glm::length(vertex.Position - p_Mesh.bounds.center));
+  }
+  p_Mesh.bounds.radius = l_fRadius;
+}
+
+SMeshOptimizeStats OptimizeMesh(MeshData &p_Mesh,
+                                const SMeshOptimizeSettings &p_Settings) {
+
+  std::vector<Vertex> &l_Vertices = p_Mesh.vertices;
+  std::vector<GLuint> &l_Indices = p_Mesh.indecies;
+
+  SMeshOptimizeStats l_Stats;
+  l_Stats.meshes = 1;
+  l_Stats.triangles = l_Indices.size() / 3;
+  l_Stats.verticesBefore = l_Vertices.size();
+
+  // only plain, valid triangle lists are touched
+  const bool l_bValid =
+      l_Indices.size() % 3 == 0 &&
+      std::all_of(l_Indices.begin(), l_Indices.end(), [&](GLuint index) {
+        return index < l_Vertices.size();
+      });
+
+  if (!l_bValid) {
+    SDL_Log("OptimizeMesh: not a valid triangle list, left as is");
+    l_Stats.verticesAfter = l_Stats.verticesBefore;
+    return l_Stats;
+  }
+
+  l_Stats.cacheMissesBefore =
+      SimulateVertexCache(l_Indices, l_Vertices.size(), p_Settings.cacheSize);
+
+  if (p_Settings.vertexCache) {
+    OptimizeVertexCache(l_Indices, l_Vertices.size());
+  }
+  if (p_Settings.overdraw) {
+    OptimizeOverdraw(l_Indices, l_Vertices, p_Settings.cacheSize);
+  }
+  if (p_Settings.vertexFetch) {
+    OptimizeVertexFetch(l_Vertices, l_Indices);
+  }
+
+  l_Stats.verticesAfter = l_Vertices.size();
+  l_Stats.cacheMissesAfter =
+      SimulateVertexCache(l_Indices, l_Vertices.size(), p_Settings.cacheSize);
+
+  return l_Stats;
+}
+
+} // namespace eHazGraphics
@@ -0,0 +1,389 @@
+#include "MeshSimplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace eHazGraphics {
+
+namespace {
+
+// Sum of the planes around a vertex as the upper half of a symmetric 4x4.
+// Planes are weighted by triangle area and the total weight is kept, so
+// Evaluate() reads as a mean squared distance.
+struct SQuadric {
+  double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+  double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+  double a22 = 0.0, a23 = 0.0;
+  double a33 = 0.0;
+  double weight = 0.0;
+
+  void AddPlane(const glm::dvec3 &n, double d, double w) {
+    a00 += w * n.x * n.x;
+    a01 += w * n.x * n.y;
+    a02 += w * n.x * n.z;
+    a03 += w * n.x * d;
+    a11 += w * n.y * n.y;
+    a12 += w * n.y * n.z;
+    a13 += w * n.y * d;
+    a22 += w * n.z * n.z;
+    a23 += w * n.z * d;
+    a33 += w * d * d;
+    weight += w;
+  }
+
+  void Add(const SQuadric &q) {
+    a00 += q.a00;
+    a01 += q.a01;
+    a02 += q.a02;
+    a03 += q.a03;
+    a11 += q.a11;
+    a12 += q.a12;
+    a13 += q.a13;
+    a22 += q.a22;
+    a23 += q.a23;
+    a33 += q.a33;
+    weight += q.weight;
+  }
+
+  double Evaluate(const glm::dvec3 &p) const {
+    double l_dError = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                      2.0 * (a01 * p.x * p.y + a02 * p.x * p.z +
+                             a12 * p.y * p.z) +
+                      2.0 * (a03 * p.x + a13 * p.y + a23 * p.z) + a33;
+
+    return weight > 0.0 ? std::max(l_dError, 0.0) / weight : 0.0;
+  }
+};
+
+struct SCollapse {
+  GLuint from;
+  GLuint to;
+  double cost;
+};
+
+} // namespace
+
+static bool PositionLess(const glm::vec3 &a, const glm::vec3 &b) {
+  if (a.x != b.x)
+    return a.x < b.x;
+  if (a.y != b.y)
+    return a.y < b.y;
+  return a.z < b.z;
+}
+
+static glm::dvec3 TriangleNormal(const glm::dvec3 &a, const glm::dvec3 &b,
+                                 const glm::dvec3 &c) {
+  return glm::cross(b - a, c - a);
+}
+
+std::vector<GLuint> SimplifyMesh(const std::vector<Vertex> &p_Vertices,
+                                 const std::vector<GLuint> &p_Indices,
+                                 size_t p_szTargetIndexCount,
+                                 float p_fTargetError, float *p_pResultError) {
+
+  std::vector<GLuint> l_Result = p_Indices;
+  if (p_pResultError)
+    *p_pResultError = 0.0f;
+
+  const size_t l_szVertexCount = p_Vertices.size();
+
+  if (l_Result.size() % 3 != 0 || l_Result.size() <= p_szTargetIndexCount)
+    return l_Result;
+
+  if (std::any_of(l_Result.begin(), l_Result.end(), [&](GLuint index) {
+        return index >= l_szVertexCount;
+      }))
+    return l_Result;
+
+  std::vector<glm::dvec3> l_Positions(l_szVertexCount);
+  for (size_t v = 0; v < l_szVertexCount; v++) {
+    l_Positions[v] = glm::dvec3(p_Vertices[v].Position);
+  }
+
+  // vertices sharing a position are split by an attribute seam, they all
+  // map to one canonical vertex and stay where they are
+  std::vector<GLuint> l_Order(l_szVertexCount);
+  std::iota(l_Order.begin(), l_Order.end(), 0);
+  std::sort(l_Order.begin(), l_Order.end(), [&](GLuint a, GLuint b) {
+    return PositionLess(p_Vertices[a].Position, p_Vertices[b].Position);
+  });
+
+  std::vector<GLuint> l_Canonical(l_szVertexCount);
+  std::vector<bool> l_Locked(l_szVertexCount, false);
+
+  for (size_t i = 0; i < l_Order.size(); i++) {
+    GLuint v = l_Order[i];
+    if (i > 0 && p_Vertices[v].Position == p_Vertices[l_Order[i - 1]].Position) {
+      l_Canonical[v] = l_Canonical[l_Order[i - 1]];
+      l_Locked[l_Canonical[v]] = true;
+    } else {
+      l_Canonical[v] = v;
+    }
+  }
+
+  // borders and non-manifold edges are locked as well
+  std::vector<uint64_t> l_Edges;
+  l_Edges.reserve(l_Result.size());
+  for (size_t i = 0; i < l_Result.size(); i += 3) {
+    for (size_t k = 0; k < 3; k++) {
+      uint64_t a = l_Canonical[l_Result[i + k]];
+      uint64_t b = l_Canonical[l_Result[i + (k + 1) % 3]];
+      l_Edges.push_back(std::min(a, b) << 32 | std::max(a, b));
+    }
+  }
+  std::sort(l_Edges.begin(), l_Edges.end());
+
+  for (size_t i = 0; i < l_Edges.size();) {
+    size_t l_szRun = i;
+    while (l_szRun < l_Edges.size() && l_Edges[l_szRun] == l_Edges[i]) {
+      l_szRun++;
+    }
+    if (l_szRun - i != 2) {
+      l_Locked[l_Edges[i] >> 32] = true;
+      l_Locked[l_Edges[i] & 0xFFFFFFFFu] = true;
+    }
+    i = l_szRun;
+  }
+
+  std::vector<SQuadric> l_Quadrics(l_szVertexCount);
+  for (size_t i = 0; i < l_Result.size(); i += 3) {
+    const glm::dvec3 &p0 = l_Positions[l_Result[i]];
+    glm::dvec3 l_Normal =
+        TriangleNormal(p0, l_Positions[l_Result[i + 1]],
+                       l_Positions[l_Result[i + 2]]);
+
+    double l_dLength = glm::length(l_Normal);
+    if (l_dLength == 0.0)
+      continue;
+
+    l_Normal /= l_dLength;
+    double l_dDistance = -glm::dot(l_Normal, p0);
+
+    for (size_t k = 0; k < 3; k++) {
+      l_Quadrics[l_Canonical[l_Result[i + k]]].AddPlane(l_Normal, l_dDistance,
+                                                        l_dLength * 0.5);
+    }
+  }
+
+  const double l_dErrorLimit =
+      static_cast<double>(p_fTargetError) * p_fTargetError;
+  double l_dMaxError = 0.0;
+
+  std::vector<SCollapse> l_Candidates;
+  std::vector<GLuint> l_Collapse(l_szVertexCount);
+  std::vector<bool> l_Touched(l_szVertexCount);
+  std::vector<uint32_t> l_Offsets(l_szVertexCount + 1);
+  std::vector<uint32_t> l_Adjacency;
+
+  // every pass collapses the cheapest edges that do not share a
+  // neighbourhood, then drops the triangles that became degenerate
+  while (l_Result.size() > p_szTargetIndexCount) {
+
+    const size_t l_szTriangleCount = l_Result.size() / 3;
+
+    l_Candidates.clear();
+    for (size_t i = 0; i < l_Result.size(); i += 3) {
+      for (size_t k = 0; k < 3; k++) {
+        GLuint a = l_Result[i + k];
+        GLuint b = l_Result[i + (k + 1) % 3];
+
+        for (int direction = 0; direction < 2; direction++) {
+          GLuint from = direction == 0 ? a : b;
+          GLuint to = direction == 0 ? b : a;
+
+          if (l_Locked[l_Canonical[from]])
+            continue;
+
+          SQuadric l_Quadric = l_Quadrics[from];
+          l_Quadric.Add(l_Quadrics[l_Canonical[to]]);
+          double l_dCost = l_Quadric.Evaluate(l_Positions[to]);
+
+          if (l_dCost <= l_dErrorLimit) {
+            l_Candidates.push_back({from, to, l_dCost});
+          }
+        }
+      }
+    }
+
+    if (l_Candidates.empty())
+      break;
+
+    std::sort(l_Candidates.begin(), l_Candidates.end(),
+              [](const SCollapse &a, const SCollapse &b) {
+                return a.cost < b.cost;
+              });
+
+    std::fill(l_Offsets.begin(), l_Offsets.end(), 0);
+    for (GLuint index : l_Result) {
+      l_Offsets[index + 1]++;
+    }
+    std::partial_sum(l_Offsets.begin(), l_Offsets.end(), l_Offsets.begin());
+
+    l_Adjacency.resize(l_Result.size());
+    {
+      std::vector<uint32_t> l_Fill(l_Offsets.begin(), l_Offsets.end() - 1);
+      for (size_t t = 0; t < l_szTriangleCount; t++) {
+        for (size_t k = 0; k < 3; k++) {
+          l_Adjacency[l_Fill[l_Result[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+      }
+    }
+
+    std::iota(l_Collapse.begin(), l_Collapse.end(), 0);
+    std::fill(l_Touched.begin(), l_Touched.end(), false);
+
+    const size_t l_szRemoveGoal =
+        (l_Result.size() - p_szTargetIndexCount) / 3;
+    size_t l_szRemoved = 0;
+    size_t l_szCollapses = 0;
+
+    for (const SCollapse &collapse : l_Candidates) {
+      if (l_szRemoved >= l_szRemoveGoal)
+        break;
+
+      if (l_Touched[collapse.from] || l_Touched[collapse.to])
+        continue;
+
+      // reject collapses that flip or flatten a remaining triangle
+      bool l_bValid = true;
+      size_t l_szShared = 0;
+
+      for (uint32_t a = l_Offsets[collapse.from];
+           a < l_Offsets[collapse.from + 1] && l_bValid; a++) {
+        const GLuint *l_pTriangle = &l_Result[l_Adjacency[a] * 3];
+
+        if (l_pTriangle[0] == collapse.to || l_pTriangle[1] == collapse.to ||
+            l_pTriangle[2] == collapse.to) {
+          l_szShared++;
+          continue;
+        }
+
+        glm::dvec3 l_Before[3];
+        glm::dvec3 l_After[3];
+        for (size_t k = 0; k < 3; k++) {
+          l_Before[k] = l_Positions[l_pTriangle[k]];
+          l_After[k] = l_pTriangle[k] == collapse.from
+                           ? l_Positions[collapse.to]
+                           : l_Before[k];
+        }
+
+        if (glm::dot(TriangleNormal(l_Before[0], l_Before[1], l_Before[2]),
+                     TriangleNormal(l_After[0], l_After[1], l_After[2])) <=
+            0.0) {
+          l_bValid = false;
+        }
+      }
+
+      if (!l_bValid)
+        continue;
+
+      l_Collapse[collapse.from] = collapse.to;
+      l_Touched[collapse.from] = true;
+      l_Touched[collapse.to] = true;
+
+      for (uint32_t a = l_Offsets[collapse.from];
+           a < l_Offsets[collapse.from + 1]; a++) {
+        for (size_t k = 0; k < 3; k++) {
+          l_Touched[l_Result[l_Adjacency[a] * 3 + k]] = true;
+        }
+      }
+
+      l_Quadrics[l_Canonical[collapse.to]].Add(l_Quadrics[collapse.from]);
+      l_dMaxError = std::max(l_dMaxError, collapse.cost);
+      l_szRemoved += l_szShared;
+      l_szCollapses++;
+    }
+
+    if (l_szCollapses == 0)
+      break;
+
+    size_t l_szWrite = 0;
+    for (size_t i = 0; i < l_Result.size(); i += 3) {
+      GLuint a = l_Collapse[l_Result[i]];
+      GLuint b = l_Collapse[l_Result[i + 1]];
+      GLuint c = l_Collapse[l_Result[i + 2]];
+
+      if (l_Canonical[a] == l_Canonical[b] ||
+          l_Canonical[b] == l_Canonical[c] || l_Canonical[a] == l_Canonical[c])
+        continue;
+
+      l_Result[l_szWrite++] = a;
+      l_Result[l_szWrite++] = b;
+      l_Result[l_szWrite++] = c;
+    }
+    l_Result.resize(l_szWrite);
+  }
+
+  if (p_pResultError)
+    *p_pResultError = static_cast<float>(std::sqrt(l_dMaxError));
+
+  return l_Result;
+}
+
+std::vector<SMeshLOD>
+GenerateMeshLODs(const MeshData &p_Mesh, const SMeshLODSettings &p_Settings,
+                 const SMeshOptimizeSettings &p_OptimizeSettings) {
+
+  std::vector<SMeshLOD> l_LODs;
+
+  const size_t l_szMinIndices = p_Settings.minTriangles * 3;
+
+  if (p_Settings.maxLODs == 0 || p_Mesh.indecies.size() <= l_szMinIndices ||
+      p_Mesh.vertices.empty())
+    return l_LODs;
+
+  glm::vec3 l_Min = p_Mesh.vertices[0].Position;
+  glm::vec3 l_Max = l_Min;
+  for (const Vertex &vertex : p_Mesh.vertices) {
+    l_Min = glm::min(l_Min, vertex.Position);
+    l_Max = glm::max(l_Max, vertex.Position);
+  }
+
+  const float l_fExtent = glm::length(l_Max - l_Min);
+  if (l_fExtent == 0.0f)
+    return l_LODs;
+
+  // the reduced levels only keep the vertices they use
+  SMeshOptimizeSettings l_OptimizeSettings = p_OptimizeSettings;
+  l_OptimizeSettings.vertexFetch = true;
+
+  size_t l_szPreviousCount = p_Mesh.indecies.size();
+  float l_fPreviousError = 0.0f;
+
+  for (uint32_t lod = 0; lod < p_Settings.maxLODs; lod++) {
+
+    if (l_szPreviousCount <= l_szMinIndices)
+      break;
+
+    size_t l_szTarget = static_cast<size_t>(l_szPreviousCount *
+                                            p_Settings.reduction) /
+                        3 * 3;
+    l_szTarget = std::max(l_szTarget, l_szMinIndices);
+
+    // always reduced from the full mesh so errors do not pile up
+    float l_fError = 0.0f;
+    std::vector<GLuint> l_Indices =
+        SimplifyMesh(p_Mesh.vertices, p_Mesh.indecies, l_szTarget,
+                     p_Settings.maxError * l_fExtent, &l_fError);
+
+    // less than a tenth saved is not worth another level
+    if (l_Indices.empty() || l_Indices.size() * 10 > l_szPreviousCount * 9)
+      break;
+
+    SMeshLOD l_LOD;
+    l_LOD.data.vertices = p_Mesh.vertices;
+    l_LOD.data.indecies = std::move(l_Indices);
+    l_LOD.error = std::max(l_fError, l_fPreviousError);
+
+    OptimizeMesh(l_LOD.data, l_OptimizeSettings);
+    ComputeMeshBounds(l_LOD.data);
+
+    l_szPreviousCount = l_LOD.data.indecies.size();
+    l_fPreviousError = l_LOD.error;
+    l_LODs.push_back(std::move(l_LOD));
+  }
+
+  return l_LODs;
+}
+
+} // namespace eHazGraphics
@@ -0,0 +1,224 @@
+#include "MeshletBuilder.hpp"
+#include "MeshOptimizer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace eHazGraphics {
+
+static constexpr uint32_t NO_MESHLET = static_cast<uint32_t>(-1);
+
+SMeshlet ComputeMeshletBounds(const MeshData &p_Mesh, uint32_t p_uiFirstIndex,
+                              uint32_t p_uiIndexCount) {
+
+  const std::vector<Vertex> &l_Vertices = p_Mesh.vertices;
+  const GLuint *l_pIndices = p_Mesh.indecies.data() + p_uiFirstIndex;
+
+  SMeshlet l_Meshlet;
+  l_Meshlet.firstIndex = p_uiFirstIndex;
+  l_Meshlet.indexCount = p_uiIndexCount;
+
+  if (p_uiIndexCount == 0)
+    return l_Meshlet;
+
+  glm::vec3 l_Min = l_Vertices[l_pIndices[0]].Position;
+  glm::vec3 l_Max = l_Min;
+  for (uint32_t i = 0; i < p_uiIndexCount; i++) {
+    l_Min = glm::min(l_Min, l_Vertices[l_pIndices[i]].Position);
+    l_Max = glm::max(l_Max, l_Vertices[l_pIndices[i]].Position);
+  }
+
+  l_Meshlet.center = (l_Min + l_Max) * 0.5f;
+  for (uint32_t i = 0; i < p_uiIndexCount; i++) {
+    l_Meshlet.radius =
+        std::max(l_Meshlet.radius,
+                 glm::length(l_Vertices[l_pIndices[i]].Position -
+                             l_Meshlet.center));
+  }
+
+  // the cone axis is the mean facing, its spread the widest triangle off it
+  std::vector<glm::vec3> l_Normals;
+  l_Normals.reserve(p_uiIndexCount / 3);
+  glm::vec3 l_Axis(0.0f);
+
+  for (uint32_t i = 0; i + 2 < p_uiIndexCount; i += 3) {
+    const glm::vec3 &a = l_Vertices[l_pIndices[i]].Position;
+    const glm::vec3 &b = l_Vertices[l_pIndices[i + 1]].Position;
+    const glm::vec3 &c = l_Vertices[l_pIndices[i + 2]].Position;
+
+    glm::vec3 l_Normal = glm::cross(b - a, c - a);
+    float l_fLength = glm::length(l_Normal);
+    if (l_fLength == 0.0f)
+      continue;
+
+    l_Normal /= l_fLength;
+    l_Normals.push_back(l_Normal);
+    l_Axis += l_Normal;
+  }
+
+  float l_fAxisLength = glm::length(l_Axis);
+  if (l_Normals.empty() || l_fAxisLength == 0.0f)
+    return l_Meshlet;
+
+  l_Axis /= l_fAxisLength;
+
+  float l_fMinDot = 1.0f;
+  for (const glm::vec3 &normal : l_Normals) {
+    l_fMinDot = std::min(l_fMinDot, glm::dot(normal, l_Axis));
+  }
+
+  l_Meshlet.coneAxis = l_Axis;
+  l_Meshlet.coneCutoff =
+      l_fMinDot <= 0.0f ? 1.0f : std::sqrt(1.0f - l_fMinDot * l_fMinDot);
+
+  return l_Meshlet;
+}
+
+std::vector<SMeshlet> BuildMeshlets(MeshData &p_Mesh,
+                                    const SMeshletSettings &p_Settings) {
+
+  std::vector<SMeshlet> l_Meshlets;
+
+  std::vector<Vertex> &l_Vertices = p_Mesh.vertices;
+  std::vector<GLuint> &l_Indices = p_Mesh.indecies;
+
+  const size_t l_szTriangleCount = l_Indices.size() / 3;
+
+  if (!p_Settings.enabled || p_Settings.maxTriangles == 0 ||
+      l_Indices.size() % 3 != 0 || l_szTriangleCount < p_Settings.minTriangles)
+    return l_Meshlets;
+
+  if (std::any_of(l_Indices.begin(), l_Indices.end(), [&](GLuint index) {
+        return index >= l_Vertices.size();
+      }))
+    return l_Meshlets;
+
+  // triangles of each vertex
+  std::vector<uint32_t> l_Offsets(l_Vertices.size() + 1, 0);
+  for (GLuint index : l_Indices) {
+    l_Offsets[index + 1]++;
+  }
+  std::partial_sum(l_Offsets.begin(), l_Offsets.end(), l_Offsets.begin());
+
+  std::vector<uint32_t> l_Adjacency(l_Indices.size());
+  {
+    std::vector<uint32_t> l_Fill(l_Offsets.begin(), l_Offsets.end() - 1);
+    for (size_t t = 0; t < l_szTriangleCount; t++) {
+      for (size_t k = 0; k < 3; k++) {
+        l_Adjacency[l_Fill[l_Indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+      }
+    }
+  }
+
+  std::vector<glm::vec3> l_Centroids(l_szTriangleCount);
+  for (size_t t = 0; t < l_szTriangleCount; t++) {
+    l_Centroids[t] = (l_Vertices[l_Indices[t * 3]].Position +
+                      l_Vertices[l_Indices[t * 3 + 1]].Position +
+                      l_Vertices[l_Indices[t * 3 + 2]].Position) /
+                     3.0f;
+  }
+
+  std::vector<bool> l_Emitted(l_szTriangleCount, false);
+  std::vector<uint32_t> l_VertexMeshlet(l_Vertices.size(), NO_MESHLET);
+  std::vector<uint32_t> l_FrontierMeshlet(l_szTriangleCount, NO_MESHLET);
+  std::vector<uint32_t> l_Frontier;
+
+  std::vector<GLuint> l_Result;
+  l_Result.reserve(l_Indices.size());
+
+  std::vector<uint32_t> l_Firsts;
+  size_t l_szSeedCursor = 0;
+
+  // grows each cluster from the next unused triangle in the cache optimized
+  // order, preferring neighbours that share the most vertices with it and
+  // then the ones closest to its centre
+  while (l_Result.size() < l_Indices.size()) {
+
+    while (l_Emitted[l_szSeedCursor]) {
+      l_szSeedCursor++;
+    }
+
+    const uint32_t l_uiMeshlet = static_cast<uint32_t>(l_Firsts.size());
+    l_Firsts.push_back(static_cast<uint32_t>(l_Result.size()));
+
+    l_Frontier.clear();
+    l_Frontier.push_back(static_cast<uint32_t>(l_szSeedCursor));
+    l_FrontierMeshlet[l_szSeedCursor] = l_uiMeshlet;
+
+    glm::vec3 l_CentroidSum(0.0f);
+    uint32_t l_uiTriangles = 0;
+
+    while (l_uiTriangles < p_Settings.maxTriangles && !l_Frontier.empty()) {
+
+      const glm::vec3 l_Centre =
+          l_uiTriangles == 0 ? l_Centroids[l_Frontier[0]]
+                             : l_CentroidSum / static_cast<float>(l_uiTriangles);
+
+      size_t l_szBest = 0;
+      int l_iBestShared = -1;
+      float l_fBestDistance = std::numeric_limits<float>::max();
+
+      for (size_t slot = 0; slot < l_Frontier.size(); slot++) {
+        uint32_t t = l_Frontier[slot];
+
+        int l_iShared = 0;
+        for (size_t k = 0; k < 3; k++) {
+          l_iShared += l_VertexMeshlet[l_Indices[t * 3 + k]] == l_uiMeshlet;
+        }
+
+        glm::vec3 l_Offset = l_Centroids[t] - l_Centre;
+        float l_fDistance = glm::dot(l_Offset, l_Offset);
+
+        if (l_iShared > l_iBestShared ||
+            (l_iShared == l_iBestShared && l_fDistance < l_fBestDistance)) {
+          l_szBest = slot;
+          l_iBestShared = l_iShared;
+          l_fBestDistance = l_fDistance;
+        }
+      }
+
+      uint32_t t = l_Frontier[l_szBest];
+      l_Frontier[l_szBest] = l_Frontier.back();
+      l_Frontier.pop_back();
+
+      l_Emitted[t] = true;
+      l_Result.insert(l_Result.end(), l_Indices.begin() + t * 3,
+                      l_Indices.begin() + t * 3 + 3);
+      l_CentroidSum += l_Centroids[t];
+      l_uiTriangles++;
+
+      for (size_t k = 0; k < 3; k++) {
+        GLuint v = l_Indices[t * 3 + k];
+        l_VertexMeshlet[v] = l_uiMeshlet;
+
+        for (uint32_t a = l_Offsets[v]; a < l_Offsets[v + 1]; a++) {
+          uint32_t neighbour = l_Adjacency[a];
+          if (!l_Emitted[neighbour] &&
+              l_FrontierMeshlet[neighbour] != l_uiMeshlet) {
+            l_FrontierMeshlet[neighbour] = l_uiMeshlet;
+            l_Frontier.push_back(neighbour);
+          }
+        }
+      }
+    }
+  }
+
+  l_Indices.swap(l_Result);
+
+  // the vertex order followed the old triangle order
+  OptimizeVertexFetch(l_Vertices, l_Indices);
+
+  l_Meshlets.reserve(l_Firsts.size());
+  for (size_t m = 0; m < l_Firsts.size(); m++) {
+    uint32_t l_uiEnd = m + 1 < l_Firsts.size()
+                           ? l_Firsts[m + 1]
+                           : static_cast<uint32_t>(l_Indices.size());
+    l_Meshlets.push_back(
+        ComputeMeshletBounds(p_Mesh, l_Firsts[m], l_uiEnd - l_Firsts[m]));
+  }
+
+  return l_Meshlets;
+}
+
+} // namespace eHazGraphics
@@ -4,7 +4,10 @@
 #include "Renderer.hpp"
 #include "ShaderManager.hpp"
 
+#include <SDL3/SDL_log.h>
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <vector>
 
 namespace eHazGraphics {
@@ -13,110 +16,585 @@ bool RenderQueue::Initialize(BufferManager *f_bufferManager) {
 
   bufferManager = f_bufferManager;
 
+  // compaction moves the meshes the persistent commands point at
+  bufferManager->AddStaticRemapListener([this](const SStaticRemapTable &remap) {
+    for (auto &command : PersistentCommands) {
+      if (command.alive) {
+        remap.Apply(command.ranges);
+      }
+    }
+    persistentChanged = true;
+  });
+
   return true;
 }
 int RenderQueue::CreateRenderCommand(const VertexIndexInfoPair &ranges,
                                      bool isStatic, unsigned int instanceDataID,
                                      unsigned int instanceCount,
-                                     ShaderComboID shaderID) {
+                                     ShaderComboID shaderID,
+                                     const SDrawSortInfo &sortInfo) {
+
+  DrawElementsIndirectCommand command =
+      BuildRenderCommand(ranges, instanceDataID, instanceCount);
+
+  CommandList &list = GetCommandList(ranges, isStatic);
+  list.push_back({command, shaderID, sortInfo});
+  return static_cast<int>(list.size() - 1);
+}
+
+int RenderQueue::CreateClusterRenderCommands(
+    const VertexIndexInfoPair &ranges, std::span<const SMeshlet> meshlets,
+    std::span<const uint32_t> visible, bool isStatic,
+    unsigned int instanceDataID, unsigned int instanceCount,
+    ShaderComboID shaderID, const SDrawSortInfo &sortInfo) {
+
+  // resolved once, the clusters only move the index window
+  DrawElementsIndirectCommand command =
+      BuildRenderCommand(ranges, instanceDataID, instanceCount);
+  const uint32_t meshFirstIndex = command.firstIndex;
+
+  CommandList &list = GetCommandList(ranges, isStatic);
+
+  for (uint32_t meshlet : visible) {
+    command.firstIndex = meshFirstIndex + meshlets[meshlet].firstIndex;
+    command.count = meshlets[meshlet].indexCount;
+    list.push_back({command, shaderID, sortInfo});
+  }
+
+  return static_cast<int>(visible.size());
+}
+
+void RenderQueue::CreateMergeableRenderCommand(const VertexIndexInfoPair &ranges,
+                                               const InstanceData &instance,
+                                               ShaderComboID shaderID,
+                                               const glm::vec3 &boundsCenter,
+                                               float boundsRadius,
+                                               const SDrawSortInfo &sortInfo) {
+
+  if (ranges.first.dataType == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+    SDL_Log("CreateMergeableRenderCommand: skinned meshes can not be merged");
+    return;
+  }
+
+  // baseInstance is resolved once the instances are placed
+  DrawElementsIndirectCommand command = BuildRenderCommand(ranges, 0, 1);
+
+  const size_t list = ListIndex(ranges.second.indexType);
+  MergeableCommands[list].push_back({command, shaderID, sortInfo});
+  MergeableInstances[list].push_back(instance);
+
+  SSphereBatch &spheres = MergeableSpheres[list];
+  spheres.x.push_back(boundsCenter.x);
+  spheres.y.push_back(boundsCenter.y);
+  spheres.z.push_back(boundsCenter.z);
+  spheres.radius.push_back(boundsRadius);
+}
+
+void RenderQueue::MergeInstancedCommands() {
+  MergeLookup.clear();
+  MergeGroups.clear();
+  MergeGroupOf.clear();
+  mergeStats = SInstanceMergeStats();
+
+  // culled before anything is grouped or uploaded
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    const SSphereBatch &spheres = MergeableSpheres[type];
+    MergeableVisible[type].resize(spheres.x.size());
+    frustumCuller.CullSpheres(spheres.x.data(), spheres.y.data(),
+                              spheres.z.data(), spheres.radius.data(),
+                              spheres.x.size(), MergeableVisible[type].data());
+  }
+
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    for (size_t i = 0; i < MergeableCommands[type].size(); i++) {
+      if (!MergeableVisible[type][i])
+        continue;
+
+      const SQueuedCommand &queued = MergeableCommands[type][i];
+      uint32_t group = static_cast<uint32_t>(MergeGroups.size());
+
+      if (instanceMerging) {
+        const SMergeKey key{static_cast<uint32_t>(type), queued.command.count,
+                            queued.command.firstIndex,
+                            queued.command.baseVertex, queued.shader};
+        group = MergeLookup.try_emplace(key, group).first->second;
+      }
+
+      if (group == MergeGroups.size()) {
+        MergeGroups.push_back({queued, static_cast<uint32_t>(type)});
+      }
+
+      // the group sorts by its closest instance
+      SDrawSortInfo &sortInfo = MergeGroups[group].queued.sortInfo;
+      sortInfo.depth = std::min(sortInfo.depth, queued.sortInfo.depth);
+
+      MergeGroups[group].instanceCount++;
+      MergeGroupOf.push_back(group);
+    }
+  }
+
+  if (MergeGroups.empty())
+    return;
+
+  uint32_t instanceTotal = 0;
+  for (auto &group : MergeGroups) {
+    group.firstInstance = instanceTotal;
+    instanceTotal += group.instanceCount;
+  }
+
+  // same traversal as above, every instance lands in its group's run
+  MergedInstances.resize(instanceTotal);
+  size_t next = 0;
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    for (size_t i = 0; i < MergeableInstances[type].size(); i++) {
+      if (!MergeableVisible[type][i])
+        continue;
+
+      SMergeGroup &group = MergeGroups[MergeGroupOf[next++]];
+      MergedInstances[group.firstInstance + group.filled++] =
+          MergeableInstances[type][i];
+    }
+  }
+
+  auto instanceBuffer =
+      bufferManager->GetTypedBuffer<TypeFlags::BUFFER_INSTANCE_DATA>();
+  const uint32_t baseInstance = instanceBuffer.GetElementIndex(
+      instanceBuffer.Insert(std::span<const InstanceData>(MergedInstances)));
+
+  for (auto &group : MergeGroups) {
+    group.queued.command.baseInstance = baseInstance + group.firstInstance;
+    group.queued.command.instanceCount = group.instanceCount;
+  }
+
+  mergeStats.submitted = instanceTotal;
+  mergeStats.merged = static_cast<uint32_t>(MergeGroups.size());
+}
+
+SRenderCommandHandle
+RenderQueue::AddStaticCommand(const VertexIndexInfoPair &ranges,
+                              const SInstanceHandle &instance,
+                              unsigned int instanceCount,
+                              ShaderComboID shaderID,
+                              const glm::vec4 &boundingSphere) {
+
+  if (ranges.first.dataType == TypeFlags::BUFFER_ANIMATED_MESH_DATA) {
+    SDL_Log("AddStaticCommand: skinned meshes can not be persistent");
+    return SRenderCommandHandle();
+  }
+
+  uint32_t index;
+  if (!FreePersistentCommands.empty()) {
+    index = FreePersistentCommands.back();
+    FreePersistentCommands.pop_back();
+  } else {
+    index = static_cast<uint32_t>(PersistentCommands.size());
+    PersistentCommands.emplace_back();
+  }
+
+  SPersistentCommand &command = PersistentCommands[index];
+  command.ranges = ranges;
+  command.instance = instance;
+  command.instanceCount = instanceCount;
+  command.shader = shaderID;
+  command.boundingSphere = boundingSphere;
+  command.generation++;
+  command.alive = true;
+
+  auto &bucket =
+      PersistentBuckets[ListIndex(ranges.second.indexType)][shaderID];
+  command.bucketPosition = static_cast<uint32_t>(bucket.size());
+  bucket.push_back(index);
+
+  persistentCount++;
+  persistentChanged = true;
+
+  return SRenderCommandHandle{index, command.generation};
+}
+
+void RenderQueue::RemoveStaticCommand(const SRenderCommandHandle &handle) {
+  if (!IsStaticCommandValid(handle))
+    return;
+
+  SPersistentCommand &command = PersistentCommands[handle.index];
+
+  auto &buckets = PersistentBuckets[ListIndex(command.ranges.second.indexType)];
+  auto it = buckets.find(command.shader);
+  auto &bucket = it->second;
+
+  // order inside a bucket does not matter, swap the last one in
+  uint32_t moved = bucket.back();
+  bucket[command.bucketPosition] = moved;
+  PersistentCommands[moved].bucketPosition = command.bucketPosition;
+  bucket.pop_back();
+
+  if (bucket.empty()) {
+    buckets.erase(it);
+  }
+
+  command.alive = false;
+  command.generation++;
+  FreePersistentCommands.push_back(handle.index);
+
+  persistentCount--;
+  persistentChanged = true;
+}
+
+bool RenderQueue::IsStaticCommandValid(
+    const SRenderCommandHandle &handle) const {
+  if (handle.index >= PersistentCommands.size())
+    return false;
+
+  return PersistentCommands[handle.index].alive &&
+         PersistentCommands[handle.index].generation == handle.generation;
+}
+
+void RenderQueue::ClearPersistentCommands() {
+  for (auto &command : PersistentCommands) {
+    command.alive = false;
+    command.generation++;
+  }
+
+  FreePersistentCommands.clear();
+  for (uint32_t i = 0; i < PersistentCommands.size(); i++) {
+    FreePersistentCommands.push_back(i);
+  }
+
+  for (auto &buckets : PersistentBuckets) {
+    buckets.clear();
+  }
+
+  persistentCount = 0;
+  persistentChanged = true;
+}
+
+void RenderQueue::RebuildPersistentCommands() {
+  PersistentUpload.clear();
+  PersistentRanges.clear();
+  PersistentBounds.clear();
+  PersistentCommandRanges.clear();
+
+  CInstanceRegistry &registry = bufferManager->GetInstanceRegistry();
+  bool movingInstances = false;
+
+  PersistentLookupRanges.clear();
+  for (const SPersistentCommand &command : PersistentCommands) {
+    PersistentLookupRanges.push_back(command.ranges.first);
+    PersistentLookupRanges.push_back(command.ranges.second);
+  }
+  PersistentAllocations.resize(PersistentLookupRanges.size());
+  bufferManager->GetAllocations(PersistentLookupRanges, PersistentAllocations);
+
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    for (const auto &[shader, bucket] : PersistentBuckets[type]) {
+
+      const size_t start = PersistentUpload.size();
+
+      for (uint32_t index : bucket) {
+        const SPersistentCommand &command = PersistentCommands[index];
+        const auto &vertexAlloc = PersistentAllocations[2 * index];
+        const auto &indexAlloc = PersistentAllocations[2 * index + 1];
+
+        // released instances and erased meshes are skipped, not drawn stale
+        if (!registry.IsValid(command.instance) || !vertexAlloc || !indexAlloc)
+          continue;
+
+        uint32_t gpuIndex = registry.GetGPUIndex(command.instance);
+        movingInstances |= gpuIndex != command.instance.index;
+
+        PersistentUpload.push_back(BuildRenderCommand(
+            command.ranges, *vertexAlloc, *indexAlloc, gpuIndex,
+            command.instanceCount));
+
+        // only the first instance's transform is known to the culling pass
+        PersistentBounds.push_back(command.instanceCount == 1
+                                       ? command.boundingSphere
+                                       : glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+        PersistentCommandRanges.push_back(
+            glm::uvec2(static_cast<uint32_t>(PersistentRanges.size()),
+                       static_cast<uint32_t>(start)));
+      }
+
+      if (PersistentUpload.size() > start) {
+        PersistentRanges.push_back({start, PersistentUpload.size() - start,
+                                    shader, TypeFlags::BUFFER_STATIC_MESH_DATA,
+                                    GetGLIndexType(static_cast<IndexType>(type)),
+                                    true});
+      }
+    }
+  }
+
+  // instances past the registry's reserved region get a new transient copy
+  // every frame until it grows, keep rebuilding while there are any
+  persistentChanged = movingInstances;
+  persistentDirtySlots = 0xFF;
+  persistentVersion++;
+}
+
+bool RenderQueue::UploadPersistentCommands() {
+  // a compaction pass moves meshes over several frames before the remap
+  // arrives, the baked offsets go stale with every step
+  const uint32_t layoutVersion = bufferManager->GetStaticLayoutVersion();
+  if (layoutVersion != staticLayoutVersion) {
+    staticLayoutVersion = layoutVersion;
+    persistentChanged = true;
+  }
+
+  if (persistentChanged) {
+    RebuildPersistentCommands();
+  }
+
+  if (PersistentUpload.empty())
+    return true;
+
+  CDynamicBuffer *drawBuffer =
+      bufferManager->GetTypedBuffer<TypeFlags::BUFFER_DRAW_CALL_DATA>()
+          .GetBuffer();
+
+  const size_t bytes =
+      PersistentUpload.size() * sizeof(DrawElementsIndirectCommand);
+  const size_t reserved = drawBuffer->GetPersistentRegionSize();
+
+  if (bytes > reserved) {
+    if (!drawBuffer->ReservePersistentRegion(std::max(bytes, reserved * 2)))
+      return false;
+
+    // the other slots never held the grown part
+    persistentDirtySlots = 0xFF;
+  }
+
+  const uint8_t slotBit =
+      static_cast<uint8_t>(1u << drawBuffer->GetWriteSlot());
+
+  if ((persistentDirtySlots & slotBit) != 0) {
+    drawBuffer->WriteRange(0, PersistentUpload.data(), bytes);
+    persistentDirtySlots &= static_cast<uint8_t>(~slotBit);
+  }
+
+  return true;
+}
+
+RenderQueue::CommandList &
+RenderQueue::GetCommandList(const VertexIndexInfoPair &ranges, bool isStatic) {
+  const size_t list = ListIndex(ranges.second.indexType);
+
+  if (ranges.first.dataType == TypeFlags::BUFFER_ANIMATED_MESH_DATA)
+    return AnimatedCommands[list];
+
+  return isStatic ? StaticCommands[list] : DynamicCommands[list];
+}
+
+DrawElementsIndirectCommand
+RenderQueue::BuildRenderCommand(const VertexIndexInfoPair &ranges,
+                                unsigned int instanceDataID,
+                                unsigned int instanceCount) {
   const SBufferRange &vertexRange = ranges.first;
   const SBufferRange &indexRange = ranges.second;
 
-  auto vAlloc = bufferManager->GetAllocation(vertexRange);
+  const SBufferRange pairRanges[2] = {vertexRange, indexRange};
+  std::optional<SAllocation> pairAllocs[2];
+  bufferManager->GetAllocations(pairRanges, pairAllocs);
 
-  auto iAlloc = bufferManager->GetAllocation(indexRange);
+  return BuildRenderCommand(ranges, *pairAllocs[0], *pairAllocs[1],
+                            instanceDataID, instanceCount);
+}
+
+DrawElementsIndirectCommand
+RenderQueue::BuildRenderCommand(const VertexIndexInfoPair &ranges,
+                                const SAllocation &vAlloc,
+                                const SAllocation &iAlloc,
+                                unsigned int instanceDataID,
+                                unsigned int instanceCount) {
+  const SBufferRange &vertexRange = ranges.first;
+  const SBufferRange &indexRange = ranges.second;
 
   DrawElementsIndirectCommand command{};
   command.count = indexRange.count;
   command.instanceCount = instanceCount;
-  command.firstIndex = iAlloc->offset / sizeof(GLuint);
-  command.baseVertex = vAlloc->offset / sizeof(Vertex);
+  command.firstIndex = iAlloc.offset / GetIndexSize(indexRange.indexType);
+  command.baseVertex =
+      vAlloc.offset / bufferManager->GetVertexStride(vertexRange);
   command.baseInstance = instanceDataID;
 
-  std::pair<DrawElementsIndirectCommand, ShaderComboID> cmd = {command,
-                                                               shaderID};
+  return command;
+}
 
-  if (isStatic) {
-    StaticCommands.push_back(cmd);
-    return static_cast<int>(StaticCommands.size() - 1);
-  } else {
-    DynamicCommands.push_back(cmd);
-    return static_cast<int>(DynamicCommands.size() - 1);
+void RenderQueue::AppendStagedCommands(const CStagingArena &arena,
+                                       bool isStatic) {
+
+  auto &lists = isStatic ? StaticCommands : DynamicCommands;
+
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    const auto &staged = arena.GetCommands(static_cast<IndexType>(type));
+    const auto &instances = arena.GetInstances();
+    auto &commands = lists[type];
+    commands.reserve(commands.size() + staged.size());
+
+    for (const auto &[command, shader] : staged) {
+      SDrawSortInfo sortInfo;
+      if (command.baseInstance < instances.size()) {
+        sortInfo.material = instances[command.baseInstance].materialID;
+      }
+
+      commands.push_back({command, shader, sortInfo});
+      commands.back().command.baseInstance =
+          arena.GetGPUIndex(command.baseInstance);
+    }
   }
 }
 
-void SortCommandsByShader(
-    std::vector<std::pair<DrawElementsIndirectCommand, ShaderComboID>>
-        &sortedCommandPairs) {
-  std::stable_sort(
-      sortedCommandPairs.begin(), sortedCommandPairs.end(),
-      [](const std::pair<DrawElementsIndirectCommand, ShaderComboID> &a,
-         const std::pair<DrawElementsIndirectCommand, ShaderComboID> &b) {
-        // First compare vertex shader hash
-        if (a.second.vertex != b.second.vertex)
-          return a.second.vertex < b.second.vertex;
+uint16_t RenderQueue::GetShaderSortIndex(const ShaderComboID &shader) {
+  auto it = ShaderSortIndices.find(shader);
+  if (it != ShaderSortIndices.end())
+    return it->second;
+
+  // past the last index shaders share one, the ranges still split on the
+  // actual shader so only the grouping suffers
+  uint16_t index = static_cast<uint16_t>(
+      std::min<size_t>(ShaderSortIndices.size(), SORT_SHADER_MASK));
+  ShaderSortIndices.emplace(shader, index);
+  return index;
+}
+
+// Lays out the key from most to least significant: pass (geometry and index
+// type, 2 bits), shader (16), material (14), depth (16), mesh (16)
+static uint64_t MakeSortKey(uint32_t pass, uint16_t shader,
+                            const SDrawSortInfo &sortInfo,
+                            const DrawElementsIndirectCommand &command) {
+
+  // non negative floats order like their bits, the top 16 below the sign
+  // give logarithmic buckets with 8 bits of mantissa each
+  uint32_t depth = 0;
+  if (sortInfo.depth > 0.0f) {
+    depth = std::min(std::bit_cast<uint32_t>(sortInfo.depth), 0x7F800000u) >>
+            15;
+  }
 
-        // Then compare fragment shader hash
-        return a.second.fragment < b.second.fragment;
-      });
+  return (static_cast<uint64_t>(pass & 0x3) << 62) |
+         (static_cast<uint64_t>(shader) << 46) |
+         (static_cast<uint64_t>(sortInfo.material & 0x3FFF) << 32) |
+         (static_cast<uint64_t>(depth & 0xFFFF) << 16) |
+         static_cast<uint64_t>(command.baseVertex & 0xFFFF);
 }
 
-std::vector<DrawRange> CreateDrawRanges(
-    std::vector<std::pair<DrawElementsIndirectCommand, ShaderComboID>>
-        &sortedCommandPairs) {
+// Stable LSD radix sort on 8-bit digits, digits every key shares are skipped
+void RenderQueue::RadixSortEntries(std::vector<SSortEntry> &entries,
+                                   std::vector<SSortEntry> &scratch) {
+  const size_t count = entries.size();
+  if (count < 2)
+    return;
+
+  std::array<std::array<uint32_t, 256>, 8> histograms{};
+  for (const auto &entry : entries) {
+    for (size_t digit = 0; digit < 8; digit++) {
+      histograms[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+    }
+  }
+
+  scratch.resize(count);
+  SSortEntry *source = entries.data();
+  SSortEntry *target = scratch.data();
 
-  std::vector<DrawRange> result;
+  for (size_t digit = 0; digit < 8; digit++) {
+    const size_t shift = digit * 8;
+    auto &histogram = histograms[digit];
 
-  size_t start = 0;
-  ShaderComboID current = sortedCommandPairs[0].second;
+    if (histogram[(source[0].key >> shift) & 0xFF] == count)
+      continue;
 
-  for (size_t i = 0; i < sortedCommandPairs.size(); ++i) {
+    uint32_t offset = 0;
+    for (auto &bucket : histogram) {
+      uint32_t size = bucket;
+      bucket = offset;
+      offset += size;
+    }
 
-    if (sortedCommandPairs[i].second != current) {
-      result.push_back({start, i - start, current});
-      start = i;
-      current = sortedCommandPairs[i].second;
+    for (size_t i = 0; i < count; i++) {
+      target[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
     }
+    std::swap(source, target);
   }
 
-  result.push_back({start, sortedCommandPairs.size() - start, current});
-
-  return result;
+  if (source != entries.data()) {
+    entries.swap(scratch);
+  }
 }
 
 std::vector<DrawRange> RenderQueue::SubmitRenderCommands() {
-  std::vector<ShaderComboID> DrawCallShaders;
   std::vector<DrawElementsIndirectCommand> allCommands;
+  std::vector<DrawRange> drawRange;
 
-  std::vector<std::pair<DrawElementsIndirectCommand, ShaderComboID>>
-      sortedCommandPairs;
-
-  for (auto cmd : StaticCommands) {
-    sortedCommandPairs.push_back(cmd);
-  }
-  for (auto cmd : DynamicCommands) {
-    sortedCommandPairs.push_back(cmd);
+  // persistent static commands come first and are already sorted, normally
+  // straight from the slot's persistent region; if it could not grow this
+  // frame they ride along with the per frame commands
+  if (UploadPersistentCommands()) {
+    drawRange = PersistentRanges;
+  } else {
+    allCommands = PersistentUpload;
+    for (DrawRange range : PersistentRanges) {
+      range.persistent = false;
+      drawRange.push_back(range);
+    }
   }
 
-  SortCommandsByShader(sortedCommandPairs);
+  const size_t transientStart = allCommands.size();
+
+  MergeInstancedCommands();
 
-  numCommands = sortedCommandPairs.size();
+  // one pass per (geometry, index type), static and dynamic commands share
+  // theirs; skinned commands go last, one VAO switch per frame
+  SortSources.clear();
+  SortEntries.clear();
 
-  auto fullSize = DynamicCommands.size() + StaticCommands.size();
-  allCommands.reserve(fullSize);
-  DrawCallShaders.reserve(fullSize);
+  auto addCommand = [&](const SQueuedCommand &queued, uint32_t pass) {
+    SortEntries.push_back({MakeSortKey(pass, GetShaderSortIndex(queued.shader),
+                                       queued.sortInfo, queued.command),
+                           static_cast<uint32_t>(SortSources.size())});
+    SortSources.push_back(&queued);
+  };
 
-  for (auto &pair : sortedCommandPairs) {
-    allCommands.push_back(pair.first);
-    DrawCallShaders.push_back(pair.second);
+  auto addPass = [&](const CommandList &commands, uint32_t pass) {
+    for (const auto &queued : commands) {
+      addCommand(queued, pass);
+    }
+  };
+
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    addPass(StaticCommands[type], static_cast<uint32_t>(type));
+    addPass(DynamicCommands[type], static_cast<uint32_t>(type));
+  }
+  for (const auto &group : MergeGroups) {
+    addCommand(group.queued, group.type);
+  }
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    addPass(AnimatedCommands[type],
+            static_cast<uint32_t>(INDEX_TYPE_COUNT + type));
   }
 
-  std::vector<DrawRange> drawRange;
+  RadixSortEntries(SortEntries, SortScratch);
 
-  drawRange = CreateDrawRanges(sortedCommandPairs);
+  // gather in key order, a new range starts with every pass or shader change
+  allCommands.reserve(transientStart + SortEntries.size());
 
-  size_t requiredSize =
-      allCommands.size() * sizeof(DrawElementsIndirectCommand);
+  for (size_t i = 0; i < SortEntries.size(); i++) {
+    const SQueuedCommand &queued = *SortSources[SortEntries[i].index];
+    const uint32_t pass = static_cast<uint32_t>(SortEntries[i].key >> 62);
+
+    if (i == 0 || pass != (SortEntries[i - 1].key >> 62) ||
+        queued.shader != drawRange.back().shader) {
+      const size_t type = pass % INDEX_TYPE_COUNT;
+      drawRange.push_back({allCommands.size(), 0, queued.shader,
+                           pass < INDEX_TYPE_COUNT
+                               ? TypeFlags::BUFFER_STATIC_MESH_DATA
+                               : TypeFlags::BUFFER_ANIMATED_MESH_DATA,
+                           GetGLIndexType(static_cast<IndexType>(type))});
+    }
+
+    drawRange.back().count++;
+    allCommands.push_back(queued.command);
+  }
+
+  numCommands = PersistentUpload.size() + SortEntries.size();
+  frustumCuller.EndFrame();
 
   //  if (numCommands == previousNumCommands &&
   //      bufferManager->GetAllocation(bufferLocation).size > 0) {
@@ -124,10 +602,10 @@ std::vector<DrawRange> RenderQueue::SubmitRenderCommands() {
   //        bufferLocation, allCommands.data(),
   //        allCommands.size() * sizeof(DrawElementsIndirectCommand));
   //  } else {
-  bufferLocation = Renderer::p_bufferManager->InsertNewDynamicData(
-      allCommands.data(),
-      allCommands.size() * sizeof(DrawElementsIndirectCommand),
-      TypeFlags::BUFFER_DRAW_CALL_DATA);
+  bufferLocation =
+      Renderer::p_bufferManager
+          ->GetTypedBuffer<TypeFlags::BUFFER_DRAW_CALL_DATA>()
+          .Insert(allCommands);
   //  previousNumCommands = numCommands;
   //  }
 
@@ -135,11 +613,19 @@ std::vector<DrawRange> RenderQueue::SubmitRenderCommands() {
 }
 
 void RenderQueue::ClearDynamicCommands() {
-  DynamicCommands.clear();
+  for (auto &commands : DynamicCommands) {
+    commands.clear();
+  }
   numCommands = 0;
 }
 void RenderQueue::ClearStaticCommnads() {
-  StaticCommands.clear();
+  for (size_t type = 0; type < INDEX_TYPE_COUNT; type++) {
+    StaticCommands[type].clear();
+    AnimatedCommands[type].clear();
+    MergeableCommands[type].clear();
+    MergeableInstances[type].clear();
+    MergeableSpheres[type].clear();
+  }
   numCommands = 0;
 }
 void RenderQueue::Destroy() {}
@@ -148,11 +634,24 @@ bool RenderQueue::UpdateDynamicCommand(
     const std::pair<DrawElementsIndirectCommand, ShaderComboID> &ID,
     std::pair<DrawElementsIndirectCommand, ShaderComboID> replacement) {
 
-  for (unsigned int i = 0; i < DynamicCommands.size(); i++) {
+  for (auto &commands : DynamicCommands) {
+    for (unsigned int i = 0; i < commands.size(); i++) {
+
+      if (commands[i].command == ID.first && commands[i].shader == ID.second) {
+        commands[i].command = replacement.first;
+        commands[i].shader = replacement.second;
+        return true;
+      }
+    }
+  }
 
-    if (DynamicCommands[i] == ID) {
-      DynamicCommands[i] = replacement;
-      return true;
+  for (auto &commands : AnimatedCommands) {
+    for (auto &queued : commands) {
+      if (queued.command == ID.first && queued.shader == ID.second) {
+        queued.command = replacement.first;
+        queued.shader = replacement.second;
+        return true;
+      }
     }
   }
 
@@ -13,6 +13,8 @@
 #include <SDL3/SDL_log.h>
 #include <SDL3/SDL_stdinc.h>
 #include <SDL3/SDL_video.h>
+#include <algorithm>
+#include <cmath>
 #include <glad/glad.h>
 #include <iostream>
 #include <memory>
@@ -216,6 +218,13 @@ bool Renderer::Initialize(int width, int height, std::string tittle,
   p_materialManager->Initialize();
 
   p_renderQueue->Initialize(p_bufferManager.get());
+
+  // a mesh pooled again after EraseMesh() gets a new matrix index, the
+  // registered instances of it still hold the old one
+  p_bufferManager->GetStaticMatrixPool().AddIndexListener(
+      [this](const MeshID &mesh, uint32_t matrixID) {
+        RetargetRegisteredStaticMeshes(mesh, matrixID);
+      });
   std::string ScreenRenderVS =
       "//@@start@@ ScreenRenderVS shader @@end@@\n"
       "#version 460 core\n"
@@ -267,63 +276,272 @@ bool Renderer::Initialize(int width, int height, std::string tittle,
   std::cout << "piss\n\n :)))";
 }
 
-void Renderer::SubmitAnimatedModel(std::shared_ptr<AnimatedModel> &model,
-                                   glm::mat4 position) {
+VertexIndexInfoPair
+Renderer::ResolveAnimatedMeshLocation(const MeshID &mesh) {
+
+  const Mesh &m_mesh = p_AnimatedModelManager->GetMesh(mesh);
+  if (m_mesh.isResident() == false) {
+    const auto &vertexPair = m_mesh.GetVertexData();
+    const auto &indexPair = m_mesh.GetIndexData();
+    WaitForGPU();
+    VertexIndexInfoPair range = p_bufferManager->InsertNewStaticData(
+        vertexPair.first, vertexPair.second, indexPair.first, indexPair.second,
+        TypeFlags::BUFFER_ANIMATED_MESH_DATA);
+
+    p_AnimatedModelManager->AddMeshLocation(mesh, range);
+    p_AnimatedModelManager->SetMeshResidency(mesh, true);
+    return range;
+  }
 
-  std::vector<SBufferRange> instanceRanges;
-  std::vector<InstanceData> instances;
+  return p_AnimatedModelManager->GetMeshLocation(mesh);
+}
 
-  for (auto &mesh : model->GetMeshIDs()) {
+VertexIndexInfoPair Renderer::ResolveStaticMeshLocation(const MeshID &mesh,
+                                                        TypeFlags dataType,
+                                                        uint32_t lod) {
+
+  const Mesh &m_mesh = p_meshManager->GetMesh(mesh);
+  if (m_mesh.isResident() == false) {
+    // every level goes up together so switching LOD never uploads
+    std::vector<SStaticMeshUpload> uploads;
+    m_mesh.AppendLODUploads(uploads);
+    WaitForGPU();
+    std::vector<VertexIndexInfoPair> ranges =
+        p_bufferManager->InsertNewStaticData(uploads, dataType);
+
+    p_meshManager->AddMeshLocation(mesh, ranges[0]);
+    p_meshManager->AddMeshLODLocations(
+        mesh, std::vector<VertexIndexInfoPair>(ranges.begin() + 1,
+                                               ranges.end()));
+    p_meshManager->SetMeshResidency(mesh, true);
+  }
 
-    VertexIndexInfoPair range;
+  return p_meshManager->GetMeshLocation(mesh, lod);
+}
 
-    const Mesh &m_mesh = p_AnimatedModelManager->GetMesh(mesh);
-    if (m_mesh.isResident() == false) {
-      const auto &vertexPair = m_mesh.GetVertexData();
-      const auto &indexPair = m_mesh.GetIndexData();
-      WaitForGPU();
-      range = p_bufferManager->InsertNewStaticData(
-          vertexPair.first, vertexPair.second, indexPair.first,
-          indexPair.second,
-          TypeFlags::BUFFER_STATIC_MESH_DATA); // TODO: add vertex pulling for
-                                               // the animated meshes
-
-      p_AnimatedModelManager->AddMeshLocation(mesh, range);
-      p_AnimatedModelManager->SetMeshResidency(mesh, true);
+void Renderer::SetView(const glm::mat4 &view, const glm::mat4 &projection) {
+  m_ViewPosition = glm::vec3(glm::inverse(view)[3]);
+  // pixels covered by one unit at distance one, projection[1][1] is
+  // cot(fov / 2)
+  m_fLODProjectionScale = projection[1][1] * vp_height * 0.5f;
+  m_bHasView = true;
 
-    } else {
-      range = p_AnimatedModelManager->GetMeshLocation(mesh);
+  p_renderQueue->GetFrustumCuller().SetViewProjection(projection * view);
+}
+
+void Renderer::SetFrustumCulling(bool enabled) {
+  p_renderQueue->GetFrustumCuller().SetEnabled(enabled);
+}
+
+bool Renderer::SetGPUCulling(bool enabled) {
+  if (enabled && !m_GPUCuller.Initialize()) {
+    SDL_Log("SetGPUCulling: compute culling unavailable, staying on the CPU");
+    m_bGPUCulling = false;
+    return false;
+  }
+
+  m_bGPUCulling = enabled;
+  return true;
+}
+
+const SCullStats &Renderer::GetCullStats() const {
+  return p_renderQueue->GetCullStats();
+}
+
+bool Renderer::IsStaticMeshVisible(const Mesh &mesh, const glm::mat4 &world) {
+  glm::vec3 center;
+  float radius;
+  TransformBoundingSphere(mesh.GetMeshData().bounds,
+                          world * mesh.GetRelativeMatrix(), center, radius);
+
+  return p_renderQueue->GetFrustumCuller().TestSphere(center, radius);
+}
+
+uint32_t Renderer::SelectStaticLOD(const Mesh &mesh,
+                                   const glm::mat4 &world) const {
+
+  const uint32_t lodCount = mesh.GetLODCount();
+  if (!m_bHasView || lodCount == 1)
+    return 0;
+
+  const glm::mat4 meshWorld = world * mesh.GetRelativeMatrix();
+
+  float scale = std::max({glm::length(glm::vec3(meshWorld[0])),
+                          glm::length(glm::vec3(meshWorld[1])),
+                          glm::length(glm::vec3(meshWorld[2]))});
+  float distance =
+      std::max(glm::length(glm::vec3(meshWorld[3]) - m_ViewPosition), 1e-4f);
+
+  const float pixelsPerUnit = m_fLODProjectionScale * scale / distance;
+
+  // coarsest level whose deviation still stays under the threshold on screen
+  uint32_t lod = 0;
+  while (lod + 1 < lodCount &&
+         mesh.GetLODError(lod + 1) * pixelsPerUnit <= m_fLODPixelError) {
+    lod++;
+  }
+
+  return lod;
+}
+
+void Renderer::CullMeshlets(const Mesh &mesh, const glm::mat4 &world,
+                            std::vector<uint32_t> &visible) const {
+
+  const std::vector<SMeshlet> &meshlets = mesh.GetMeshlets();
+  visible.clear();
+
+  const glm::mat4 meshWorld = world * mesh.GetRelativeMatrix();
+  const glm::vec3 axisX = glm::vec3(meshWorld[0]);
+  const glm::vec3 axisY = glm::vec3(meshWorld[1]);
+  const glm::vec3 axisZ = glm::vec3(meshWorld[2]);
+
+  // mirrored transforms flip the winding, the cones would point backwards
+  const bool coneCulling = m_bMeshletConeCulling &&
+                           glm::dot(glm::cross(axisX, axisY), axisZ) > 0.0f;
+
+  // the other instances of an instanced mesh have their own transforms
+  const bool frustumCulling = m_bMeshletFrustumCulling &&
+                              mesh.GetInstanceCount() == 1 &&
+                              p_renderQueue->GetFrustumCuller().IsEnabled();
+  const SFrustum &frustum = p_renderQueue->GetFrustumCuller().GetFrustum();
+
+  const float scale = std::max(
+      {glm::length(axisX), glm::length(axisY), glm::length(axisZ)});
+
+  for (uint32_t i = 0; i < meshlets.size(); i++) {
+    const SMeshlet &meshlet = meshlets[i];
+    const glm::vec3 center =
+        glm::vec3(meshWorld * glm::vec4(meshlet.center, 1.0f));
+
+    if (frustumCulling) {
+      const float radius = meshlet.radius * scale;
+      bool inside = true;
+      for (const glm::vec4 &plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+          inside = false;
+          break;
+        }
+      }
+      if (!inside)
+        continue;
+    }
+
+    if (coneCulling && meshlet.coneCutoff < 1.0f) {
+      glm::vec3 axis = glm::normalize(axisX * meshlet.coneAxis.x +
+                                      axisY * meshlet.coneAxis.y +
+                                      axisZ * meshlet.coneAxis.z);
+      glm::vec3 toCenter = center - m_ViewPosition;
+
+      // every triangle faces away from anywhere inside the sphere
+      if (glm::dot(toCenter, axis) >=
+          meshlet.coneCutoff * glm::length(toCenter) +
+              meshlet.radius * scale)
+        continue;
+    }
+
+    visible.push_back(i);
+  }
+}
+
+bool Renderer::UsesMeshletCommands(const Mesh &mesh, uint32_t lod) const {
+  // clusters only exist for LOD 0 and only help when something gets culled
+  if (lod != 0 || mesh.GetMeshlets().empty() || !m_bHasView)
+    return false;
+
+  return m_bMeshletConeCulling ||
+         (m_bMeshletFrustumCulling &&
+          p_renderQueue->GetFrustumCuller().IsEnabled());
+}
+
+void Renderer::CreateStaticMeshCommands(const VertexIndexInfoPair &range,
+                                        const Mesh &mesh, uint32_t lod,
+                                        const glm::mat4 &world,
+                                        unsigned int instanceID,
+                                        uint32_t materialID) {
+
+  const SDrawSortInfo sortInfo = MakeSortInfo(materialID, world);
+
+  if (UsesMeshletCommands(mesh, lod)) {
+
+    CullMeshlets(mesh, world, m_VisibleMeshlets);
+
+    if (m_VisibleMeshlets.size() != mesh.GetMeshlets().size()) {
+      p_renderQueue->CreateClusterRenderCommands(
+          range, mesh.GetMeshlets(), m_VisibleMeshlets, true, instanceID,
+          mesh.GetInstanceCount(), mesh.GetShaderID(), sortInfo);
+      return;
     }
+  }
+
+  p_renderQueue->CreateRenderCommand(range, true, instanceID,
+                                     mesh.GetInstanceCount(),
+                                     mesh.GetShaderID(), sortInfo);
+}
+
+SDrawSortInfo Renderer::MakeSortInfo(uint32_t materialID,
+                                     const glm::mat4 &world) const {
+  SDrawSortInfo sortInfo;
+  sortInfo.material = materialID;
+
+  if (m_bHasView) {
+    sortInfo.depth = glm::length(glm::vec3(world[3]) - m_ViewPosition);
+  }
+
+  return sortInfo;
+}
+
+uint32_t Renderer::ResolveStaticMatrixID(const MeshID &mesh) {
+
+  return p_meshManager->GetMeshTransformID(mesh);
+}
 
-    auto &animator =
-        p_AnimatedModelManager->GetAnimator(model->GetAnimatorID());
-    // TODO: ADD CHECKS FOR NULLOPT and for the static asw
-    size_t animatorMatrixOffset =
-        p_bufferManager->GetAllocation(animator->GetGPULocation())->offset;
+InstanceData
+Renderer::BuildAnimatedInstance(std::shared_ptr<AnimatedModel> &model,
+                                const glm::mat4 &position) {
 
-    uint32_t matID = animatorMatrixOffset / sizeof(glm::mat4);
+  auto &animator = p_AnimatedModelManager->GetAnimator(model->GetAnimatorID());
+  // TODO: ADD CHECKS FOR NULLOPT and for the static asw
+  size_t animatorMatrixOffset =
+      p_bufferManager->GetAllocation(animator->GetGPULocation())->offset;
 
-    unsigned int numJoints = model->GetSkeleton()->m_Joints.size();
+  uint32_t matID = animatorMatrixOffset / sizeof(glm::mat4);
 
-    unsigned int jointLocation = animatorMatrixOffset / sizeof(glm::mat4);
+  unsigned int numJoints = model->GetSkeleton()->m_Joints.size();
 
-    InstanceData instData{position, model->GetMaterialID(), matID, numJoints,
-                          jointLocation};
+  unsigned int jointLocation = animatorMatrixOffset / sizeof(glm::mat4);
 
-    SBufferRange instanceData = p_bufferManager->InsertNewDynamicData(
-        &instData, sizeof(InstanceData), TypeFlags::BUFFER_INSTANCE_DATA);
+  return InstanceData{position, model->GetMaterialID(), matID, numJoints,
+                      jointLocation};
+}
+
+void Renderer::SubmitAnimatedModel(std::shared_ptr<AnimatedModel> &model,
+                                   glm::mat4 position) {
+
+  std::vector<SBufferRange> instanceRanges;
+  std::vector<InstanceData> instances;
+
+  auto instanceBuffer =
+      p_bufferManager->GetTypedBuffer<TypeFlags::BUFFER_INSTANCE_DATA>();
+
+  // every mesh shares the model's animator, resolve its matrices once
+  const InstanceData instData = BuildAnimatedInstance(model, position);
 
-    size_t instanceOffset =
-        p_bufferManager->GetAllocation(instanceData)->offset;
+  for (auto &mesh : model->GetMeshIDs()) {
+
+    VertexIndexInfoPair range = ResolveAnimatedMeshLocation(mesh);
 
-    size_t instanceID = instanceOffset / sizeof(InstanceData);
+    const Mesh &m_mesh = p_AnimatedModelManager->GetMesh(mesh);
+
+    SBufferRange instanceData = instanceBuffer.Insert(instData);
+
+    size_t instanceID = instanceBuffer.GetElementIndex(instanceData);
 
     instanceRanges.push_back(instanceData);
     instances.push_back(instData);
 
-    int cmdID = p_renderQueue->CreateRenderCommand(range, true, instanceID,
-                                                   m_mesh.GetInstanceCount(),
-                                                   m_mesh.GetShaderID());
+    int cmdID = p_renderQueue->CreateRenderCommand(
+        range, true, instanceID, m_mesh.GetInstanceCount(),
+        m_mesh.GetShaderID(), MakeSortInfo(instData.materialID, position));
   }
 
   p_AnimatedModelManager->AddSubmittedModel(model);
@@ -338,71 +556,276 @@ void Renderer::SubmitStaticModel(std::shared_ptr<Model> &model,
   std::vector<SBufferRange> instanceRanges;
   std::vector<InstanceData> instances;
 
-  for (auto &mesh : model->GetMeshIDs()) {
+  auto instanceBuffer =
+      p_bufferManager->GetTypedBuffer<TypeFlags::BUFFER_INSTANCE_DATA>();
 
-    VertexIndexInfoPair range;
+  for (auto &mesh : model->GetMeshIDs()) {
 
     const Mesh &m_mesh = p_meshManager->GetMesh(mesh);
-    if (m_mesh.isResident() == false) {
-      const auto &vertexPair = m_mesh.GetVertexData();
-      const auto &indexPair = m_mesh.GetIndexData();
-      WaitForGPU();
-      range = p_bufferManager->InsertNewStaticData(
-          vertexPair.first, vertexPair.second, indexPair.first,
-          indexPair.second, dataType);
-      p_meshManager->AddMeshLocation(mesh, range);
-      p_meshManager->SetMeshResidency(mesh, true);
-
-     // p_meshManager->AddTransformRange(mesh, p_bufferManager->InsertNewDynamicData(&m_mesh.GetRelativeMatrix(), sizeof(glm::mat4),
-     //     TypeFlags::BUFFER_STATIC_MATRIX_DATA));
 
-    } else {
-      range = p_meshManager->GetMeshLocation(mesh);
-    }
+    uint32_t lod = SelectStaticLOD(m_mesh, position);
+    VertexIndexInfoPair range = ResolveStaticMeshLocation(mesh, dataType, lod);
 
     // TODO: Get the instance data from the model and create the necessary
     // render commands
 
-    glm::mat4 meshMat = p_meshManager->GetMeshTransform(mesh);
+    uint32_t matID = ResolveStaticMatrixID(mesh);
 
-    SBufferRange matLocation;
-
-    if (p_meshManager->ContainsTransformRange(mesh)) {
-
-      matLocation = p_meshManager->GetTransformBufferRange(mesh);
-    } else {
+    InstanceData instData{position, model->GetMaterialID(), matID};
 
-      matLocation = p_bufferManager->InsertNewDynamicData(
-          &meshMat, sizeof(meshMat), TypeFlags::BUFFER_STATIC_MATRIX_DATA);
-      p_meshManager->AddTransformRange(mesh, matLocation);
+    // single instances of whole meshes are merged with the other submissions
+    // of the mesh, the render queue culls them in batches and places their
+    // instance data at submit
+    if (m_mesh.GetInstanceCount() == 1 && !UsesMeshletCommands(m_mesh, lod)) {
+      glm::vec3 center;
+      float radius;
+      TransformBoundingSphere(m_mesh.GetMeshData().bounds,
+                              position * m_mesh.GetRelativeMatrix(), center,
+                              radius);
+
+      p_renderQueue->CreateMergeableRenderCommand(
+          range, instData, m_mesh.GetShaderID(), center, radius,
+          MakeSortInfo(instData.materialID, position));
+
+      instanceRanges.push_back(SBufferRange());
+      instances.push_back(instData);
+      continue;
     }
 
-    size_t matOffset = p_bufferManager->GetAllocation(matLocation)->offset;
-
-    uint32_t matID = matOffset / sizeof(glm::mat4);
+    if (!IsStaticMeshVisible(m_mesh, position))
+      continue;
 
-    InstanceData instData{position, model->GetMaterialID(), matID};
+    SBufferRange instanceData = instanceBuffer.Insert(instData);
 
-    SBufferRange instanceData = p_bufferManager->InsertNewDynamicData(
-        &instData, sizeof(InstanceData), TypeFlags::BUFFER_INSTANCE_DATA);
-
-    size_t instanceOffset =
-        p_bufferManager->GetAllocation(instanceData)->offset;
-
-    size_t instanceID = instanceOffset / sizeof(InstanceData);
+    size_t instanceID = instanceBuffer.GetElementIndex(instanceData);
 
     instanceRanges.push_back(instanceData);
     instances.push_back(instData);
 
-    int cmdID = p_renderQueue->CreateRenderCommand(range, true, instanceID,
-                                                   m_mesh.GetInstanceCount(),
-                                                   m_mesh.GetShaderID());
+    CreateStaticMeshCommands(range, m_mesh, lod, position, instanceID,
+                             model->GetMaterialID());
   }
 
   p_meshManager->AddSubmittedModel(model);
   // model->SetInstances(instances, instanceRanges);
   model->AddInstances(instances, instanceRanges);
 }
+
+std::vector<SInstanceHandle>
+Renderer::RegisterStaticModel(std::shared_ptr<Model> &model,
+                              glm::mat4 position, TypeFlags dataType) {
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+  std::vector<SInstanceHandle> handles;
+  handles.reserve(model->GetMeshIDs().size());
+
+  for (auto &mesh : model->GetMeshIDs()) {
+
+    ResolveStaticMeshLocation(mesh, dataType);
+
+    InstanceData instData{position, model->GetMaterialID(),
+                          ResolveStaticMatrixID(mesh)};
+
+    handles.push_back(registry.Register(instData));
+
+    // released handles are only dropped here and when the mesh is retargeted
+    auto &meshHandles = m_RegisteredStaticMeshes[mesh];
+    std::erase_if(meshHandles, [&](const SInstanceHandle &handle) {
+      return !registry.IsValid(handle);
+    });
+    meshHandles.push_back(handles.back());
+  }
+
+  return handles;
+}
+
+std::vector<SInstanceHandle>
+Renderer::RegisterAnimatedModel(std::shared_ptr<AnimatedModel> &model,
+                                glm::mat4 position) {
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+  std::vector<SInstanceHandle> handles;
+  handles.reserve(model->GetMeshIDs().size());
+
+  const InstanceData instData = BuildAnimatedInstance(model, position);
+
+  for (auto &mesh : model->GetMeshIDs()) {
+
+    ResolveAnimatedMeshLocation(mesh);
+
+    handles.push_back(registry.Register(instData));
+  }
+
+  return handles;
+}
+
+void Renderer::SetRegisteredModelTransform(
+    const std::vector<SInstanceHandle> &handles, const glm::mat4 &position) {
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+
+  for (const auto &handle : handles) {
+    registry.SetTransform(handle, position);
+  }
+}
+
+void Renderer::SubmitRegisteredStaticModel(
+    std::shared_ptr<Model> &model, const std::vector<SInstanceHandle> &handles,
+    TypeFlags dataType) {
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+  const auto &meshIDs = model->GetMeshIDs();
+
+  for (size_t i = 0; i < meshIDs.size() && i < handles.size(); i++) {
+
+    auto instData = registry.Get(handles[i]);
+    if (!instData) {
+      SDL_Log("SubmitRegisteredStaticModel: released instance handle");
+      continue;
+    }
+
+    const Mesh &m_mesh = p_meshManager->GetMesh(meshIDs[i]);
+
+    if (!IsStaticMeshVisible(m_mesh, instData->worldMat))
+      continue;
+
+    uint32_t lod = SelectStaticLOD(m_mesh, instData->worldMat);
+    VertexIndexInfoPair range =
+        ResolveStaticMeshLocation(meshIDs[i], dataType, lod);
+
+    CreateStaticMeshCommands(range, m_mesh, lod, instData->worldMat,
+                             registry.GetGPUIndex(handles[i]),
+                             instData->materialID);
+  }
+}
+
+void Renderer::SubmitRegisteredAnimatedModel(
+    std::shared_ptr<AnimatedModel> &model,
+    const std::vector<SInstanceHandle> &handles) {
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+  const auto &meshIDs = model->GetMeshIDs();
+
+  // the joint matrices are shared by every mesh, only the transform differs
+  const InstanceData animated = BuildAnimatedInstance(model, glm::mat4(1.0f));
+
+  for (size_t i = 0; i < meshIDs.size() && i < handles.size(); i++) {
+
+    auto instData = registry.Get(handles[i]);
+    if (!instData) {
+      SDL_Log("SubmitRegisteredAnimatedModel: released instance handle");
+      continue;
+    }
+
+    VertexIndexInfoPair range = ResolveAnimatedMeshLocation(meshIDs[i]);
+
+    const Mesh &m_mesh = p_AnimatedModelManager->GetMesh(meshIDs[i]);
+
+    // joint matrices move whenever the animation buffer is rewritten
+    InstanceData current = animated;
+    current.worldMat = instData->worldMat;
+    if (current.animMatLocation != instData->animMatLocation ||
+        current.modelMatID != instData->modelMatID ||
+        current.numJoints != instData->numJoints) {
+      registry.Update(handles[i], current);
+    }
+
+    p_renderQueue->CreateRenderCommand(
+        range, true, registry.GetGPUIndex(handles[i]),
+        m_mesh.GetInstanceCount(), m_mesh.GetShaderID(),
+        MakeSortInfo(current.materialID, current.worldMat));
+  }
+}
+
+void Renderer::RetargetRegisteredStaticMeshes(const MeshID &mesh,
+                                              uint32_t matrixID) {
+  auto it = m_RegisteredStaticMeshes.find(mesh);
+  if (it == m_RegisteredStaticMeshes.end())
+    return;
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+  std::vector<SInstanceHandle> &handles = it->second;
+
+  std::erase_if(handles, [&](const SInstanceHandle &handle) {
+    auto instData = registry.Get(handle);
+    if (!instData)
+      return true;
+
+    if (instData->modelMatID != matrixID) {
+      instData->modelMatID = matrixID;
+      registry.Update(handle, *instData);
+    }
+    return false;
+  });
+
+  if (handles.empty())
+    m_RegisteredStaticMeshes.erase(it);
+}
+
+void Renderer::ReleaseRegisteredModel(std::vector<SInstanceHandle> &handles) {
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+
+  for (const auto &handle : handles) {
+    registry.Release(handle);
+  }
+  handles.clear();
+}
+std::vector<SRenderCommandHandle> Renderer::AddPersistentStaticModel(
+    std::shared_ptr<Model> &model, const std::vector<SInstanceHandle> &handles,
+    TypeFlags dataType) {
+
+  CInstanceRegistry &registry = p_bufferManager->GetInstanceRegistry();
+  const auto &meshIDs = model->GetMeshIDs();
+
+  std::vector<SRenderCommandHandle> commands;
+  commands.reserve(meshIDs.size());
+
+  for (size_t i = 0; i < meshIDs.size() && i < handles.size(); i++) {
+
+    auto instData = registry.Get(handles[i]);
+    if (!instData) {
+      SDL_Log("AddPersistentStaticModel: released instance handle");
+      continue;
+    }
+
+    VertexIndexInfoPair range = ResolveStaticMeshLocation(meshIDs[i], dataType);
+
+    const Mesh &m_mesh = p_meshManager->GetMesh(meshIDs[i]);
+
+    // the culling pass applies the instance transform on top
+    glm::vec3 center;
+    float radius;
+    TransformBoundingSphere(m_mesh.GetMeshData().bounds,
+                            m_mesh.GetRelativeMatrix(), center, radius);
+
+    commands.push_back(p_renderQueue->AddStaticCommand(
+        range, handles[i], m_mesh.GetInstanceCount(), m_mesh.GetShaderID(),
+        glm::vec4(center, std::isinf(radius) ? -1.0f : radius)));
+  }
+
+  return commands;
+}
+
+void Renderer::RemovePersistentStaticModel(
+    std::vector<SRenderCommandHandle> &commands) {
+
+  for (const auto &command : commands) {
+    p_renderQueue->RemoveStaticCommand(command);
+  }
+  commands.clear();
+}
+
+void Renderer::SubmitStagingArenas(std::span<CStagingArena *const> arenas,
+                                   bool isStatic) {
+
+  p_bufferManager->MergeStagingArenas(arenas);
+
+  for (CStagingArena *arena : arenas) {
+    p_renderQueue->AppendStagedCommands(*arena, isStatic);
+  }
+}
+
 SBufferRange Renderer::SubmitDynamicData(const void *data, size_t dataSize,
                                          TypeFlags dataType) {
   SBufferRange rt;
@@ -439,22 +862,85 @@ void Renderer::RenderFrame(std::vector<DrawRange> DrawOrder) {
     return;
   }
 
+  // the indirect buffer is bound whole, so offsets start at its slot region
+  const GLintptr slotBase =
+      p_bufferManager->GetBoundSlotOffset(TypeFlags::BUFFER_DRAW_CALL_DATA);
+  GLintptr commandBase = slotBase;
+  if (auto commands = p_bufferManager->GetAllocation(
+          p_renderQueue->GetCommandBufferLocation())) {
+    commandBase += commands->offset;
+  }
+
+  // persistent commands cull themselves on the gpu against the bound
+  // instances, they are only uploaded to the culler after they changed
+  const bool gpuCulling = m_bGPUCulling && m_bHasView &&
+                          p_renderQueue->GetFrustumCuller().IsEnabled();
+  if (gpuCulling) {
+    if (m_uiGPUCullVersion != p_renderQueue->GetPersistentVersion()) {
+      m_GPUCuller.SetCommands(p_renderQueue->GetPersistentCommands(),
+                              p_renderQueue->GetPersistentBounds(),
+                              p_renderQueue->GetPersistentCommandRanges(),
+                              p_renderQueue->GetPersistentRangeCount());
+      m_uiGPUCullVersion = p_renderQueue->GetPersistentVersion();
+    }
+
+    m_GPUCuller.Dispatch(p_renderQueue->GetFrustumCuller().GetFrustum());
+  }
+
+  TypeFlags boundGeometry = TypeFlags::BUFFER_STATIC_MESH_DATA;
+  bool cullerBound = false;
+  uint32_t persistentRange = 0;
+
   for (const auto &range : DrawOrder) {
+    if (range.geometry != boundGeometry) {
+      p_bufferManager->BindStaticBuffer(range.geometry);
+      boundGeometry = range.geometry;
+    }
+
     p_shaderManager->UseProgramme(range.shader);
-    GLintptr offset = range.startIndex * sizeof(DrawElementsIndirectCommand);
 
-    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void *)offset,
+    if (gpuCulling && range.persistent) {
+      if (!cullerBound) {
+        m_GPUCuller.BindForDrawing();
+        cullerBound = true;
+      }
+      m_GPUCuller.DrawCulledRange(persistentRange++, range);
+      continue;
+    }
+
+    if (cullerBound) {
+      p_bufferManager->BindDynamicBuffer(TypeFlags::BUFFER_DRAW_CALL_DATA);
+      cullerBound = false;
+    }
+
+    GLintptr offset = (range.persistent ? slotBase : commandBase) +
+                      range.startIndex * sizeof(DrawElementsIndirectCommand);
+
+    glMultiDrawElementsIndirect(GL_TRIANGLES, range.indexType, (void *)offset,
                                 range.count, 0);
   }
 
   //  SDL_GL_SwapWindow(p_window->GetWindowPtr());
 
+  // fenced only now so the fences cover the culling pass and the draws
+  p_bufferManager->FenceWrittenSlots();
+  // BeginWritting() already cleared the instance slot and the registry has
+  // refilled it, clearing it again would drop the registry's copies
   p_bufferManager->BeginWritting();
-  ClearRenderCommandBuffer();
   p_renderQueue->ClearDynamicCommands();
   p_renderQueue->ClearStaticCommnads();
   p_meshManager->ClearSubmittedModelInstances();
   p_AnimatedModelManager->ClearSubmittedModelInstances();
+
+  UpdateMemoryReport();
+  m_MemoryBudget.Evaluate(m_MemoryReport);
+}
+
+void Renderer::UpdateMemoryReport() {
+  // keeps the vector's capacity, no allocation after the first frame
+  m_MemoryReport.buffers.clear();
+  p_bufferManager->GetMemoryStats(m_MemoryReport.buffers);
+  m_MemoryReport.textures = p_materialManager->GetTextureMemoryStats();
 }
 
 void Renderer::UpdateRenderer(float deltatime) {
@@ -470,6 +956,7 @@ void Renderer::UpdateRenderer(float deltatime) {
 
 void Renderer::Destroy() {
 
+  m_GPUCuller.Destroy();
   p_meshManager->Destroy();
   p_renderQueue->Destroy();
   //  bufferManager.Destroy();
@@ -0,0 +1,33 @@
+#include "StagingArena.hpp"
+
+namespace eHazGraphics {
+
+CStagingArena::CStagingArena() {}
+
+CStagingArena::CStagingArena(size_t p_szInstanceReserve,
+                             size_t p_szCommandReserve) {
+  m_Instances.reserve(p_szInstanceReserve);
+  m_Commands[0].reserve(p_szCommandReserve);
+}
+
+uint32_t CStagingArena::PushInstance(const InstanceData &p_Instance) {
+  m_Instances.push_back(p_Instance);
+  return static_cast<uint32_t>(m_Instances.size() - 1);
+}
+
+void CStagingArena::PushDrawCommand(const DrawElementsIndirectCommand &p_Command,
+                                    const ShaderComboID &p_Shader,
+                                    IndexType p_IndexType) {
+  m_Commands[static_cast<size_t>(p_IndexType)].emplace_back(p_Command,
+                                                            p_Shader);
+}
+
+void CStagingArena::Reset() {
+  m_Instances.clear();
+  for (auto &commands : m_Commands) {
+    commands.clear();
+  }
+  m_uiBaseInstance = INVALID_ALLOCATION;
+}
+
+} // namespace eHazGraphics
@@ -0,0 +1,324 @@
+#include "StaticHeap.hpp"
+#include "StaticStack.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+
+namespace eHazGraphics {
+
+CGLStaticHeap::CGLStaticHeap() {}
+
+CGLStaticHeap::CGLStaticHeap(size_t p_szInitialVertSize,
+                             size_t p_szInitialIndexSize,
+                             uint32_t p_StaticHeapID)
+    : m_StaticHeapID(p_StaticHeapID) {
+
+  m_Vertex.bufferSize = std::max<size_t>(p_szInitialVertSize, 1024UL);
+  m_Index.bufferSize = std::max<size_t>(p_szInitialIndexSize, 1024UL);
+
+  glCreateBuffers(1, &m_Vertex.buffer);
+  glCreateBuffers(1, &m_Index.buffer);
+  glCreateVertexArrays(1, &m_glVertexArray);
+
+  glNamedBufferData(m_Vertex.buffer, m_Vertex.bufferSize, nullptr,
+                    GL_DYNAMIC_DRAW);
+  glNamedBufferData(m_Index.buffer, m_Index.bufferSize, nullptr,
+                    GL_DYNAMIC_DRAW);
+
+  CGLStaticStack::ConfigureVertexArray(m_glVertexArray, m_Vertex.buffer,
+                                       m_Index.buffer);
+}
+
+VertexIndexInfoPair CGLStaticHeap::Insert(const Vertex *p_vertexData,
+                                          size_t p_VertexDataSize,
+                                          const GLuint *p_IndexData,
+                                          size_t p_IndexDataSize) {
+
+  SBufferRange l_brVertexRange =
+      Allocate(m_Vertex, SlotType::VERTEX_SLOT, p_VertexDataSize,
+               sizeof(Vertex), p_vertexData);
+  SBufferRange l_brIndexRange =
+      Allocate(m_Index, SlotType::INDEX_SLOT, p_IndexDataSize, sizeof(GLuint),
+               p_IndexData);
+
+  return {l_brVertexRange, l_brIndexRange};
+}
+
+VertexIndexInfoPair CGLStaticHeap::Insert(const MeshData &p_StaticData) {
+
+  return Insert(p_StaticData.vertices.data(),
+                p_StaticData.vertices.size() * sizeof(Vertex),
+                p_StaticData.indecies.data(),
+                p_StaticData.indecies.size() * sizeof(GLuint));
+}
+
+std::vector<VertexIndexInfoPair>
+CGLStaticHeap::Insert(std::span<const SStaticMeshUpload> p_Meshes) {
+
+  size_t l_szVertexBytes = 0;
+  size_t l_szIndexBytes = 0;
+  for (const SStaticMeshUpload &mesh : p_Meshes) {
+    l_szVertexBytes += mesh.vertexDataSize;
+    l_szIndexBytes += mesh.indexDataSize;
+  }
+
+  // sized as if no hole gets reused, so Allocate() never has to grow
+  if (m_Vertex.cursor + l_szVertexBytes > m_Vertex.bufferSize) {
+    Grow(m_Vertex, m_Vertex.cursor + l_szVertexBytes);
+  }
+  if (m_Index.cursor + l_szIndexBytes > m_Index.bufferSize) {
+    Grow(m_Index, m_Index.cursor + l_szIndexBytes);
+  }
+
+  std::vector<VertexIndexInfoPair> l_Pairs;
+  l_Pairs.reserve(p_Meshes.size());
+
+  for (const SStaticMeshUpload &mesh : p_Meshes) {
+    l_Pairs.push_back(Insert(mesh.vertexData, mesh.vertexDataSize,
+                             mesh.indexData, mesh.indexDataSize));
+  }
+
+  return l_Pairs;
+}
+
+SBufferRange CGLStaticHeap::Allocate(SArena &p_Arena, SlotType p_Slot,
+                                     size_t p_szSize, size_t p_szElementSize,
+                                     const void *p_pData) {
+
+  // every block stays a whole number of elements, so offsets always convert
+  // to baseVertex / firstIndex exactly
+  size_t l_szBlockSize =
+      (p_szSize + p_szElementSize - 1) / p_szElementSize * p_szElementSize;
+
+  size_t l_szOffset;
+
+  if (auto l_Hole = p_Arena.TakeFreeBlock(l_szBlockSize)) {
+    l_szOffset = *l_Hole;
+  } else {
+    if (p_Arena.cursor + l_szBlockSize > p_Arena.bufferSize) {
+      Grow(p_Arena, p_Arena.cursor + l_szBlockSize);
+    }
+
+    l_szOffset = p_Arena.cursor;
+    p_Arena.cursor += l_szBlockSize;
+    p_Arena.highWaterMark = std::max(p_Arena.highWaterMark, p_Arena.cursor);
+  }
+
+  p_Arena.occupiedSize += l_szBlockSize;
+
+  uint32_t l_uiID;
+  if (!p_Arena.freeIDs.empty()) {
+    l_uiID = p_Arena.freeIDs.back();
+    p_Arena.freeIDs.pop_back();
+  } else {
+    l_uiID = static_cast<uint32_t>(p_Arena.allocations.size());
+    p_Arena.allocations.emplace_back();
+  }
+
+  SAllocation &l_Allocation = p_Arena.allocations[l_uiID];
+  l_Allocation.offset = l_szOffset;
+  l_Allocation.size = l_szBlockSize;
+  l_Allocation.alive = true;
+  l_Allocation.generation++;
+
+  if (p_szSize > 0) {
+    glNamedBufferSubData(p_Arena.buffer, l_szOffset, p_szSize, p_pData);
+  }
+
+  SBufferRange l_Range;
+  l_Range.handle.bufferID = m_StaticHeapID;
+  l_Range.handle.slot = p_Slot;
+  l_Range.handle.allocationID = l_uiID;
+  l_Range.handle.generation = l_Allocation.generation;
+  l_Range.dataType = TypeFlags::BUFFER_STATIC_MESH_DATA;
+  l_Range.count = static_cast<uint32_t>(p_szSize / p_szElementSize);
+  return l_Range;
+}
+
+void CGLStaticHeap::InvalidateRange(const SBufferRange &p_range) {
+  if (!isRangeValid(p_range))
+    return;
+
+  SArena &l_Arena = GetArena(p_range.handle.slot);
+  SAllocation &l_Allocation = l_Arena.allocations[p_range.handle.allocationID];
+
+  l_Arena.Release(l_Allocation.offset, l_Allocation.size);
+
+  // bumping the generation here makes every copy of the handle stale
+  l_Allocation.alive = false;
+  l_Allocation.generation++;
+  l_Arena.freeIDs.push_back(p_range.handle.allocationID);
+}
+
+bool CGLStaticHeap::isRangeValid(const SBufferRange &p_range) const {
+  if (p_range.handle.bufferID != m_StaticHeapID)
+    return false;
+
+  if (p_range.handle.slot != SlotType::VERTEX_SLOT &&
+      p_range.handle.slot != SlotType::INDEX_SLOT)
+    return false;
+
+  const SArena &l_Arena = GetArena(p_range.handle.slot);
+  if (p_range.handle.allocationID >= l_Arena.allocations.size())
+    return false;
+
+  const SAllocation &l_Allocation =
+      l_Arena.allocations[p_range.handle.allocationID];
+  return l_Allocation.alive &&
+         l_Allocation.generation == p_range.handle.generation;
+}
+
+std::optional<SAllocation>
+CGLStaticHeap::GetAllocation(const SBufferRange &p_range) const {
+  if (!isRangeValid(p_range))
+    return std::nullopt;
+
+  return GetArena(p_range.handle.slot).allocations[p_range.handle.allocationID];
+}
+
+void CGLStaticHeap::BindBuffer() { glBindVertexArray(m_glVertexArray); }
+
+void CGLStaticHeap::BindStorage(GLuint p_uiVertexBinding,
+                                GLuint p_uiIndexBinding) const {
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, p_uiVertexBinding,
+                   m_Vertex.buffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, p_uiIndexBinding,
+                   m_Index.buffer);
+}
+
+void CGLStaticHeap::Clear() {
+  m_Vertex.Reset();
+  m_Index.Reset();
+}
+
+SBufferMemoryStats CGLStaticHeap::GetMemoryStats() const {
+
+  SBufferMemoryStats l_Stats;
+  l_Stats.capacityBytes = m_Vertex.bufferSize + m_Index.bufferSize;
+  l_Stats.occupiedBytes = m_Vertex.occupiedSize + m_Index.occupiedSize;
+  l_Stats.wastedBytes = (m_Vertex.cursor - m_Vertex.occupiedSize) +
+                        (m_Index.cursor - m_Index.occupiedSize);
+  return l_Stats;
+}
+
+void CGLStaticHeap::Destroy() {
+  glDeleteBuffers(1, &m_Vertex.buffer);
+  glDeleteBuffers(1, &m_Index.buffer);
+  glDeleteVertexArrays(1, &m_glVertexArray);
+
+  m_Vertex.buffer = 0;
+  m_Index.buffer = 0;
+  m_glVertexArray = 0;
+}
+
+void CGLStaticHeap::Grow(SArena &p_Arena, size_t p_szMinimumSize) {
+
+  size_t l_szNewSize = std::max(2 * p_Arena.bufferSize, p_szMinimumSize);
+
+  GLuint l_glNewBuffer;
+  glCreateBuffers(1, &l_glNewBuffer);
+  glNamedBufferData(l_glNewBuffer, l_szNewSize, nullptr, GL_DYNAMIC_DRAW);
+
+  // ordered after the draws already issued, no need to wait on the GPU
+  if (p_Arena.cursor > 0) {
+    glCopyNamedBufferSubData(p_Arena.buffer, l_glNewBuffer, 0, 0,
+                             p_Arena.cursor);
+  }
+
+  glDeleteBuffers(1, &p_Arena.buffer);
+
+  p_Arena.buffer = l_glNewBuffer;
+  p_Arena.bufferSize = l_szNewSize;
+
+  CGLStaticStack::ConfigureVertexArray(m_glVertexArray, m_Vertex.buffer,
+                                       m_Index.buffer);
+
+  SDL_Log("CGLStaticHeap %u grew an arena to %zu bytes", m_StaticHeapID,
+          l_szNewSize);
+}
+
+std::optional<size_t> CGLStaticHeap::SArena::TakeFreeBlock(size_t p_szSize) {
+
+  auto fit = freeBlocksBySize.lower_bound(p_szSize);
+  if (fit == freeBlocksBySize.end())
+    return std::nullopt;
+
+  size_t l_szOffset = fit->second;
+  size_t l_szBlockSize = fit->first;
+
+  EraseFreeBlock(freeBlocks.find(l_szOffset));
+
+  if (l_szBlockSize > p_szSize) {
+    InsertFreeBlock(l_szOffset + p_szSize, l_szBlockSize - p_szSize);
+  }
+
+  return l_szOffset;
+}
+
+void CGLStaticHeap::SArena::Release(size_t p_szOffset, size_t p_szSize) {
+
+  occupiedSize -= p_szSize;
+
+  if (p_szSize == 0)
+    return;
+
+  auto next = freeBlocks.lower_bound(p_szOffset);
+  if (next != freeBlocks.begin()) {
+    auto prev = std::prev(next);
+    if (prev->first + prev->second == p_szOffset) {
+      p_szOffset = prev->first;
+      p_szSize += prev->second;
+      EraseFreeBlock(prev);
+    }
+  }
+
+  next = freeBlocks.lower_bound(p_szOffset);
+  if (next != freeBlocks.end() && p_szOffset + p_szSize == next->first) {
+    p_szSize += next->second;
+    EraseFreeBlock(next);
+  }
+
+  // a hole touching the cursor just hands the space back to the bump region
+  if (p_szOffset + p_szSize == cursor) {
+    cursor = p_szOffset;
+    return;
+  }
+
+  InsertFreeBlock(p_szOffset, p_szSize);
+}
+
+void CGLStaticHeap::SArena::InsertFreeBlock(size_t p_szOffset,
+                                            size_t p_szSize) {
+  freeBlocks.emplace(p_szOffset, p_szSize);
+  freeBlocksBySize.emplace(p_szSize, p_szOffset);
+}
+
+void CGLStaticHeap::SArena::EraseFreeBlock(
+    std::map<size_t, size_t>::iterator p_it) {
+
+  auto range = freeBlocksBySize.equal_range(p_it->second);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == p_it->first) {
+      freeBlocksBySize.erase(it);
+      break;
+    }
+  }
+  freeBlocks.erase(p_it);
+}
+
+void CGLStaticHeap::SArena::Reset() {
+  // generations survive so handles from before the clear stay stale
+  for (uint32_t i = 0; i < allocations.size(); i++) {
+    if (allocations[i].alive) {
+      allocations[i].alive = false;
+      allocations[i].generation++;
+      freeIDs.push_back(i);
+    }
+  }
+
+  freeBlocks.clear();
+  freeBlocksBySize.clear();
+  cursor = 0;
+  occupiedSize = 0;
+}
+
+} // namespace eHazGraphics
@@ -0,0 +1,170 @@
+#include "StaticMatrixPool.hpp"
+#include <SDL3/SDL_log.h>
+#include <algorithm>
+
+namespace eHazGraphics {
+
+CStaticMatrixPool::CStaticMatrixPool() {}
+
+CStaticMatrixPool::CStaticMatrixPool(CDynamicBuffer *p_pMatrixBuffer,
+                                     uint32_t p_uiInitialCapacity)
+    : m_pMatrixBuffer(p_pMatrixBuffer) {
+
+  m_uiAllSlotsMask =
+      static_cast<uint8_t>((1u << m_pMatrixBuffer->GetSlotCount()) - 1u);
+
+  GrowTo(p_uiInitialCapacity);
+}
+
+uint32_t CStaticMatrixPool::SetMatrix(const MeshID &p_Mesh,
+                                      const glm::mat4 &p_Matrix) {
+
+  auto it = m_Indices.find(p_Mesh);
+  if (it != m_Indices.end()) {
+    uint32_t l_uiIndex = it->second;
+
+    if (m_Matrices[l_uiIndex] != p_Matrix) {
+      m_Matrices[l_uiIndex] = p_Matrix;
+      MarkDirty(l_uiIndex);
+    }
+    return l_uiIndex;
+  }
+
+  uint32_t l_uiIndex;
+
+  if (!m_FreeIndices.empty()) {
+    l_uiIndex = m_FreeIndices.back();
+    m_FreeIndices.pop_back();
+    m_Matrices[l_uiIndex] = p_Matrix;
+  } else {
+    l_uiIndex = static_cast<uint32_t>(m_Matrices.size());
+    m_Matrices.push_back(p_Matrix);
+    m_DirtySlots.push_back(0);
+  }
+
+  m_Indices.emplace(p_Mesh, l_uiIndex);
+  MarkDirty(l_uiIndex);
+
+  // the index is handed out right away, so the region has to cover it before
+  // this frame's Flush()
+  if (l_uiIndex >= m_uiCapacity &&
+      !GrowTo(std::max<uint32_t>(m_uiCapacity * 2, l_uiIndex + 1))) {
+    SDL_Log("CStaticMatrixPool::SetMatrix: matrix %u is past the reserved "
+            "region until the next frame",
+            l_uiIndex);
+  }
+
+  for (auto &listener : m_IndexListeners) {
+    listener(p_Mesh, l_uiIndex);
+  }
+
+  return l_uiIndex;
+}
+
+void CStaticMatrixPool::Remove(const MeshID &p_Mesh) {
+  auto it = m_Indices.find(p_Mesh);
+  if (it == m_Indices.end())
+    return;
+
+  // the stale GPU copy is never referenced again, no write needed
+  m_DirtySlots[it->second] = 0;
+  m_FreeIndices.push_back(it->second);
+  m_Indices.erase(it);
+}
+
+std::optional<uint32_t>
+CStaticMatrixPool::GetMatrixID(const MeshID &p_Mesh) const {
+  auto it = m_Indices.find(p_Mesh);
+  if (it == m_Indices.end())
+    return std::nullopt;
+
+  return it->second;
+}
+
+void CStaticMatrixPool::Reserve() {
+  if (m_Matrices.size() > m_uiCapacity) {
+    GrowTo(std::max<uint32_t>(m_uiCapacity * 2,
+                              static_cast<uint32_t>(m_Matrices.size())));
+  }
+}
+
+void CStaticMatrixPool::Flush() {
+
+  m_uiLastFlushRanges = 0;
+
+  if (m_DirtyIndices.empty())
+    return;
+
+  const uint8_t l_uiSlotBit = GetWriteSlotBit();
+
+  // sorted so neighbouring entries go out as a single WriteRange
+  std::sort(m_DirtyIndices.begin(), m_DirtyIndices.end());
+
+  size_t l_szKept = 0;
+  uint32_t l_uiRunStart = 0;
+  uint32_t l_uiRunLength = 0;
+
+  auto l_WriteRun = [&]() {
+    if (l_uiRunLength == 0)
+      return;
+
+    m_pMatrixBuffer->WriteRange(l_uiRunStart * sizeof(glm::mat4),
+                                &m_Matrices[l_uiRunStart],
+                                l_uiRunLength * sizeof(glm::mat4));
+    m_uiLastFlushRanges++;
+    l_uiRunLength = 0;
+  };
+
+  for (size_t i = 0; i < m_DirtyIndices.size(); i++) {
+    uint32_t l_uiIndex = m_DirtyIndices[i];
+
+    if ((m_DirtySlots[l_uiIndex] & l_uiSlotBit) != 0 &&
+        l_uiIndex < m_uiCapacity) {
+
+      if (l_uiRunLength != 0 && l_uiRunStart + l_uiRunLength != l_uiIndex)
+        l_WriteRun();
+
+      if (l_uiRunLength == 0)
+        l_uiRunStart = l_uiIndex;
+      l_uiRunLength++;
+
+      m_DirtySlots[l_uiIndex] &= static_cast<uint8_t>(~l_uiSlotBit);
+    }
+
+    if (m_DirtySlots[l_uiIndex] != 0)
+      m_DirtyIndices[l_szKept++] = l_uiIndex;
+  }
+  l_WriteRun();
+
+  m_DirtyIndices.resize(l_szKept);
+}
+
+void CStaticMatrixPool::Clear() {
+  m_Indices.clear();
+  m_Matrices.clear();
+  m_DirtySlots.clear();
+  m_FreeIndices.clear();
+  m_DirtyIndices.clear();
+}
+
+void CStaticMatrixPool::MarkDirty(uint32_t p_uiIndex) {
+  if (m_DirtySlots[p_uiIndex] == 0)
+    m_DirtyIndices.push_back(p_uiIndex);
+
+  m_DirtySlots[p_uiIndex] = m_uiAllSlotsMask;
+}
+
+bool CStaticMatrixPool::GrowTo(uint32_t p_uiCount) {
+  if (!m_pMatrixBuffer->ReservePersistentRegion(p_uiCount *
+                                                sizeof(glm::mat4)))
+    return false;
+
+  m_uiCapacity = std::max(m_uiCapacity, p_uiCount);
+  return true;
+}
+
+uint8_t CStaticMatrixPool::GetWriteSlotBit() const {
+  return static_cast<uint8_t>(1u << m_pMatrixBuffer->GetWriteSlot());
+}
+
+} // namespace eHazGraphics
@@ -6,17 +6,42 @@
 #include <StaticStack.hpp>
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
 #include <optional>
 
 namespace eHazGraphics {
 
+static PackedVertex PackVertex(const Vertex &p_Vertex) {
+  PackedVertex l_Packed;
+  l_Packed.Position = p_Vertex.Position;
+  l_Packed.UV = glm::packHalf2x16(p_Vertex.UV);
+  l_Packed.Normal = glm::packSnorm3x10_1x2(glm::vec4(p_Vertex.Normal, 0.0f));
+
+  // the bitangent is rebuilt in the shader as cross(N, T) * w
+  float l_fSign = p_Vertex.Tangent.w;
+  if (l_fSign == 0.0f) {
+    glm::vec3 l_Tangent = glm::vec3(p_Vertex.Tangent);
+    l_fSign = glm::dot(glm::cross(p_Vertex.Normal, l_Tangent),
+                       p_Vertex.Bitangent) < 0.0f
+                  ? -1.0f
+                  : 1.0f;
+  }
+  l_Packed.Tangent = glm::packSnorm3x10_1x2(
+      glm::vec4(glm::vec3(p_Vertex.Tangent), l_fSign < 0.0f ? -1.0f : 1.0f));
+
+  return l_Packed;
+}
+
 CGLStaticStack::CGLStaticStack() {}
 CGLStaticStack::CGLStaticStack(size_t p_szInitialVertSize,
                                size_t p_szInitialIndexSize,
-                               uint32_t p_StaticStackID)
+                               uint32_t p_StaticStackID,
+                               VertexFormat p_Format, TypeFlags p_DataType)
     : m_szIndexBufferSize(p_szInitialIndexSize),
       m_szVertexBufferSize(p_szInitialVertSize),
-      m_StaticStackID(p_StaticStackID)
+      m_StaticStackID(p_StaticStackID), m_VertexFormat(p_Format),
+      m_DataType(p_DataType)
 
 {
   m_szVertexOccupiedSize = 0;
@@ -53,28 +78,188 @@ CGLStaticStack::GetAllocation(const SBufferRange &p_range) const {
 
   return std::nullopt;
 }
+// 0xFFFF is left out so a 16 bit range never hits the primitive restart index
+static constexpr GLuint MAX_NARROW_INDEX = 0xFFFE;
+
+// every index allocation starts 4 byte aligned, so firstIndex stays exact for
+// both index types and compaction never has to know which one it moves
+static size_t AlignIndexOffset(size_t p_szOffset) {
+  return (p_szOffset + 3) & ~static_cast<size_t>(3);
+}
+
+IndexType CGLStaticStack::ChooseIndexType(const GLuint *p_IndexData,
+                                          size_t p_szIndexCount) const {
+  if (!m_bNarrowIndices)
+    return IndexType::UINT32;
+
+  for (size_t i = 0; i < p_szIndexCount; i++) {
+    if (p_IndexData[i] > MAX_NARROW_INDEX)
+      return IndexType::UINT32;
+  }
+  return IndexType::UINT16;
+}
+
 VertexIndexInfoPair CGLStaticStack::push_back(const Vertex *p_vertexData,
                                               size_t p_VertexDataSize,
                                               const GLuint *p_IndexData,
                                               size_t p_IndexDataSize) {
 
+  const size_t l_szVertexCount = p_VertexDataSize / sizeof(Vertex);
+  const void *l_pVertexUpload = p_vertexData;
+
+  if (m_VertexFormat == VertexFormat::PACKED) {
+    m_PackedVertices.resize(l_szVertexCount);
+    for (size_t i = 0; i < l_szVertexCount; i++) {
+      m_PackedVertices[i] = PackVertex(p_vertexData[i]);
+    }
+    l_pVertexUpload = m_PackedVertices.data();
+    p_VertexDataSize = l_szVertexCount * sizeof(PackedVertex);
+  }
+
+  const size_t l_szIndexCount = p_IndexDataSize / sizeof(GLuint);
+  const IndexType l_IndexType = ChooseIndexType(p_IndexData, l_szIndexCount);
+  const void *l_pIndexUpload = p_IndexData;
+
+  if (l_IndexType == IndexType::UINT16) {
+    m_NarrowIndices.assign(p_IndexData, p_IndexData + l_szIndexCount);
+    l_pIndexUpload = m_NarrowIndices.data();
+    p_IndexDataSize = l_szIndexCount * sizeof(GLushort);
+  }
+
+  const size_t l_szIndexOffset = AlignIndexOffset(m_szIndexCursor);
+
   if (m_szVertexOccupiedSize + p_VertexDataSize >= m_szVertexBufferSize ||
-      m_szIndexOccupiedSize + p_IndexDataSize >= m_szIndexBufferSize) {
-    ResizeGLBuffer(p_VertexDataSize, p_IndexDataSize);
+      l_szIndexOffset + p_IndexDataSize >= m_szIndexBufferSize) {
+    ResizeGLBuffer(p_VertexDataSize, l_szIndexOffset + p_IndexDataSize + 1);
+  }
+
+  const size_t l_szVertexOffset = m_szVertexCursor;
+
+  VertexIndexInfoPair l_Pair =
+      PushAllocation(p_VertexDataSize, p_IndexDataSize, l_IndexType);
+
+  glNamedBufferSubData(m_glVertexBuffer, l_szVertexOffset, p_VertexDataSize,
+                       l_pVertexUpload);
+
+  glNamedBufferSubData(m_glIndexBuffer, l_szIndexOffset, p_IndexDataSize,
+                       l_pIndexUpload);
+
+  return l_Pair;
+}
+
+std::vector<VertexIndexInfoPair>
+CGLStaticStack::push_back(std::span<const SStaticMeshUpload> p_Meshes) {
+
+  const size_t l_szStride = GetVertexStride();
+
+  size_t l_szVertexBytes = 0;
+  for (const SStaticMeshUpload &mesh : p_Meshes) {
+    l_szVertexBytes += mesh.vertexDataSize / sizeof(Vertex) * l_szStride;
+  }
+
+  // index layout first, each mesh picks its own index type
+  std::vector<IndexType> l_IndexTypes(p_Meshes.size());
+  const size_t l_szIndexOffset = AlignIndexOffset(m_szIndexCursor);
+  size_t l_szIndexEnd = l_szIndexOffset;
+
+  for (size_t i = 0; i < p_Meshes.size(); i++) {
+    const size_t l_szIndexCount = p_Meshes[i].indexDataSize / sizeof(GLuint);
+    l_IndexTypes[i] = ChooseIndexType(p_Meshes[i].indexData, l_szIndexCount);
+    l_szIndexEnd = AlignIndexOffset(l_szIndexEnd) +
+                   l_szIndexCount * GetIndexSize(l_IndexTypes[i]);
+  }
+
+  const size_t l_szIndexBytes = l_szIndexEnd - l_szIndexOffset;
+
+  std::vector<VertexIndexInfoPair> l_Pairs;
+  l_Pairs.reserve(p_Meshes.size());
+
+  // grows (and waits on the GPU) at most once for the whole batch
+  if (m_szVertexCursor + l_szVertexBytes >= m_szVertexBufferSize ||
+      l_szIndexEnd >= m_szIndexBufferSize) {
+    ResizeGLBuffer(m_szVertexCursor + l_szVertexBytes + 1, l_szIndexEnd + 1);
+  }
+
+  const size_t l_szVertexOffset = m_szVertexCursor;
+
+  m_VertexStaging.resize(l_szVertexBytes);
+  m_IndexStaging.assign(l_szIndexBytes, 0);
+
+  size_t l_szVertexWrite = 0;
+
+  for (size_t m = 0; m < p_Meshes.size(); m++) {
+    const SStaticMeshUpload &mesh = p_Meshes[m];
+    const size_t l_szVertexCount = mesh.vertexDataSize / sizeof(Vertex);
+    const size_t l_szMeshVertexBytes = l_szVertexCount * l_szStride;
+    const size_t l_szIndexCount = mesh.indexDataSize / sizeof(GLuint);
+
+    if (m_VertexFormat == VertexFormat::PACKED) {
+      for (size_t i = 0; i < l_szVertexCount; i++) {
+        PackedVertex l_Packed = PackVertex(mesh.vertexData[i]);
+        std::memcpy(m_VertexStaging.data() + l_szVertexWrite +
+                        i * sizeof(PackedVertex),
+                    &l_Packed, sizeof(PackedVertex));
+      }
+    } else if (l_szMeshVertexBytes > 0) {
+      std::memcpy(m_VertexStaging.data() + l_szVertexWrite, mesh.vertexData,
+                  l_szMeshVertexBytes);
+    }
+
+    l_Pairs.push_back(PushAllocation(
+        l_szMeshVertexBytes, l_szIndexCount * GetIndexSize(l_IndexTypes[m]),
+        l_IndexTypes[m]));
+
+    unsigned char *l_pIndexDst = m_IndexStaging.data() +
+                                 m_IndexAllcoations.back().offset -
+                                 l_szIndexOffset;
+
+    if (l_IndexTypes[m] == IndexType::UINT16) {
+      for (size_t i = 0; i < l_szIndexCount; i++) {
+        GLushort l_usIndex = static_cast<GLushort>(mesh.indexData[i]);
+        std::memcpy(l_pIndexDst + i * sizeof(GLushort), &l_usIndex,
+                    sizeof(GLushort));
+      }
+    } else if (l_szIndexCount > 0) {
+      std::memcpy(l_pIndexDst, mesh.indexData, mesh.indexDataSize);
+    }
+
+    l_szVertexWrite += l_szMeshVertexBytes;
+  }
+
+  if (l_szVertexBytes > 0) {
+    glNamedBufferSubData(m_glVertexBuffer, l_szVertexOffset, l_szVertexBytes,
+                         m_VertexStaging.data());
+  }
+  if (l_szIndexBytes > 0) {
+    glNamedBufferSubData(m_glIndexBuffer, l_szIndexOffset, l_szIndexBytes,
+                         m_IndexStaging.data());
   }
 
+  // a level load can stage hundreds of MB, do not keep it around
+  m_VertexStaging.clear();
+  m_VertexStaging.shrink_to_fit();
+  m_IndexStaging.clear();
+  m_IndexStaging.shrink_to_fit();
+
+  return l_Pairs;
+}
+
+VertexIndexInfoPair CGLStaticStack::PushAllocation(size_t p_szVertexBytes,
+                                                   size_t p_szIndexBytes,
+                                                   IndexType p_IndexType) {
+
   SAllocation l_allNewVAlloc;
   SAllocation l_allNewIAlloc;
 
   l_allNewVAlloc.alive = true;
   l_allNewVAlloc.generation = m_uiGlobalGeneration;
   l_allNewVAlloc.offset = m_szVertexCursor;
-  l_allNewVAlloc.size = p_VertexDataSize;
+  l_allNewVAlloc.size = p_szVertexBytes;
 
   l_allNewIAlloc.alive = true;
   l_allNewIAlloc.generation = m_uiGlobalGeneration;
-  l_allNewIAlloc.offset = m_szIndexCursor;
-  l_allNewIAlloc.size = p_IndexDataSize;
+  l_allNewIAlloc.offset = AlignIndexOffset(m_szIndexCursor);
+  l_allNewIAlloc.size = p_szIndexBytes;
 
   SBufferRange l_brVertexRange;
   SBufferRange l_brIndexRange;
@@ -98,25 +283,28 @@ VertexIndexInfoPair CGLStaticStack::push_back(const Vertex *p_vertexData,
   l_bhIndexHandle.generation = m_uiGlobalGeneration;
   l_bhIndexHandle.slot = SlotType::INDEX_SLOT;
 
-  l_brVertexRange.count = p_VertexDataSize / sizeof(Vertex);
-  l_brVertexRange.dataType = TypeFlags::BUFFER_STATIC_MESH_DATA;
+  l_brVertexRange.count =
+      static_cast<uint32_t>(p_szVertexBytes / GetVertexStride());
+  l_brVertexRange.dataType = m_DataType;
   l_brVertexRange.handle = l_bhVertexHandle;
 
-  l_brIndexRange.count = p_IndexDataSize / sizeof(GLuint);
-  l_brIndexRange.dataType = TypeFlags::BUFFER_STATIC_MESH_DATA;
+  l_brIndexRange.count = p_szIndexBytes / GetIndexSize(p_IndexType);
+  l_brIndexRange.dataType = m_DataType;
   l_brIndexRange.handle = l_bhIndexHandle;
+  l_brIndexRange.indexType = p_IndexType;
 
-  glNamedBufferSubData(m_glVertexBuffer, l_allNewVAlloc.offset,
-                       p_VertexDataSize, p_vertexData);
-
-  glNamedBufferSubData(m_glIndexBuffer, l_allNewIAlloc.offset, p_IndexDataSize,
-                       p_IndexData);
+  // alignment padding counts as occupied so the occupied size keeps
+  // matching the cursor
+  const size_t l_szIndexPadding = l_allNewIAlloc.offset - m_szIndexCursor;
 
   m_szVertexCursor = l_allNewVAlloc.offset + l_allNewVAlloc.size;
   m_szIndexCursor = l_allNewIAlloc.offset + l_allNewIAlloc.size;
 
-  m_szVertexOccupiedSize += p_VertexDataSize;
-  m_szIndexOccupiedSize += p_IndexDataSize;
+  m_szVertexOccupiedSize += p_szVertexBytes;
+  m_szIndexOccupiedSize += l_szIndexPadding + p_szIndexBytes;
+
+  m_szVertexHighWaterMark = std::max(m_szVertexHighWaterMark, m_szVertexCursor);
+  m_szIndexHighWaterMark = std::max(m_szIndexHighWaterMark, m_szIndexCursor);
 
   return {l_brVertexRange, l_brIndexRange};
 }
@@ -135,6 +323,8 @@ void CGLStaticStack::InvalidateRange(const SBufferRange &p_range) {
     case SlotType::VERTEX_SLOT: {
 
       m_VertexAllocations[p_range.handle.allocationID].alive = false;
+      m_szVertexDeadSize +=
+          m_VertexAllocations[p_range.handle.allocationID].size;
       if (p_range.handle.allocationID == m_VertexAllocations.size() - 1) {
         pop_back();
       }
@@ -142,6 +332,8 @@ void CGLStaticStack::InvalidateRange(const SBufferRange &p_range) {
     case SlotType::INDEX_SLOT: {
 
       m_IndexAllcoations[p_range.handle.allocationID].alive = false;
+      m_szIndexDeadSize +=
+          m_IndexAllcoations[p_range.handle.allocationID].size;
       if (p_range.handle.allocationID == m_IndexAllcoations.size() - 1) {
         pop_back();
       }
@@ -177,6 +369,9 @@ bool CGLStaticStack::isRangeValid(const SBufferRange &p_range) const {
         m_IndexAllcoations[p_range.handle.allocationID];
     if (p_range.handle.generation != m_uiGlobalGeneration)
       return false;
+    if (!l_allIndex.alive)
+      return false;
+
     if (l_allIndex.offset + l_allIndex.size <= m_szIndexCursor)
       return true;
     else
@@ -199,6 +394,18 @@ bool CGLStaticStack::isRangeValid(const SBufferRange &p_range) const {
   }
 }
 void CGLStaticStack::BindBuffer() { glBindVertexArray(m_glVertexArray); }
+
+// the pulling shaders index the storage by these strides
+static_assert(sizeof(Vertex) == 23 * sizeof(uint32_t));
+static_assert(sizeof(PackedVertex) == 6 * sizeof(uint32_t));
+
+void CGLStaticStack::BindStorage(GLuint p_uiVertexBinding,
+                                 GLuint p_uiIndexBinding) const {
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, p_uiVertexBinding,
+                   m_glVertexBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, p_uiIndexBinding,
+                   m_glIndexBuffer);
+}
 void CGLStaticStack::pop_back() {
 
   while (!m_VertexAllocations.empty()) {
@@ -213,12 +420,182 @@ void CGLStaticStack::pop_back() {
     m_szVertexCursor = v.offset;
     m_szIndexCursor = i.offset;
 
-    m_szVertexOccupiedSize -= v.size;
-    m_szIndexOccupiedSize -= i.size;
+    // the index cursor may have skipped alignment padding, which counts as
+    // occupied, so rewind to the cursor instead of subtracting the size
+    m_szVertexOccupiedSize = m_szVertexCursor;
+    m_szIndexOccupiedSize = m_szIndexCursor;
+    m_szVertexDeadSize -= v.size;
+    m_szIndexDeadSize -= i.size;
 
     m_VertexAllocations.pop_back();
     m_IndexAllcoations.pop_back();
   }
+
+  if (m_bCompacting) {
+    m_uiCompactionCursor = std::min<uint32_t>(
+        m_uiCompactionCursor, static_cast<uint32_t>(m_VertexAllocations.size()));
+    m_szCompactVertexDst = std::min(m_szCompactVertexDst, m_szVertexCursor);
+    m_szCompactIndexDst = std::min(m_szCompactIndexDst, m_szIndexCursor);
+  }
+}
+
+void CGLStaticStack::BeginCompaction() {
+  if (m_bCompacting)
+    return;
+
+  m_bCompacting = true;
+  m_uiCompactionCursor = 0;
+  m_szCompactVertexDst = 0;
+  m_szCompactIndexDst = 0;
+}
+
+bool CGLStaticStack::StepCompaction(size_t p_szMaxBytes) {
+  if (!m_bCompacting)
+    return false;
+
+  size_t l_szMoved = 0;
+
+  while (m_uiCompactionCursor < m_VertexAllocations.size() &&
+         l_szMoved < p_szMaxBytes) {
+
+    SAllocation &l_Vertex = m_VertexAllocations[m_uiCompactionCursor];
+    SAllocation &l_Index = m_IndexAllcoations[m_uiCompactionCursor];
+
+    if (l_Vertex.alive) {
+      if (l_Vertex.offset != m_szCompactVertexDst) {
+        MoveRange(m_glVertexBuffer, l_Vertex.offset, m_szCompactVertexDst,
+                  l_Vertex.size);
+        l_Vertex.offset = m_szCompactVertexDst;
+        l_szMoved += l_Vertex.size;
+      }
+      m_szCompactVertexDst += l_Vertex.size;
+    }
+
+    if (l_Index.alive) {
+      m_szCompactIndexDst = AlignIndexOffset(m_szCompactIndexDst);
+      if (l_Index.offset != m_szCompactIndexDst) {
+        MoveRange(m_glIndexBuffer, l_Index.offset, m_szCompactIndexDst,
+                  l_Index.size);
+        l_Index.offset = m_szCompactIndexDst;
+        l_szMoved += l_Index.size;
+      }
+      m_szCompactIndexDst += l_Index.size;
+    }
+
+    m_uiCompactionCursor++;
+  }
+
+  if (l_szMoved > 0)
+    m_uiLayoutVersion++;
+
+  if (m_uiCompactionCursor < m_VertexAllocations.size())
+    return false;
+
+  FinishCompaction();
+  return true;
+}
+
+void CGLStaticStack::MoveRange(GLuint p_glBuffer, size_t p_szSrc,
+                               size_t p_szDst, size_t p_szSize) {
+
+  // GL orders the copy after every draw already issued, so frames still in
+  // flight read the old offsets before they are overwritten
+  if (p_szSrc - p_szDst >= p_szSize) {
+    glCopyNamedBufferSubData(p_glBuffer, p_glBuffer, p_szSrc, p_szDst,
+                             p_szSize);
+    return;
+  }
+
+  if (m_glScratchBuffer == 0) {
+    glCreateBuffers(1, &m_glScratchBuffer);
+    glNamedBufferStorage(m_glScratchBuffer, COMPACTION_CHUNK_SIZE, nullptr, 0);
+  }
+
+  // overlapping ranges: going up in chunks only ever overwrites source
+  // bytes that were already copied out
+  for (size_t l_szDone = 0; l_szDone < p_szSize;) {
+    size_t l_szChunk = std::min(COMPACTION_CHUNK_SIZE, p_szSize - l_szDone);
+
+    glCopyNamedBufferSubData(p_glBuffer, m_glScratchBuffer,
+                             p_szSrc + l_szDone, 0, l_szChunk);
+    glCopyNamedBufferSubData(m_glScratchBuffer, p_glBuffer, 0,
+                             p_szDst + l_szDone, l_szChunk);
+    l_szDone += l_szChunk;
+  }
+}
+
+void CGLStaticStack::FinishCompaction() {
+
+  m_RemapTable.bufferID = m_StaticStackID;
+  m_RemapTable.oldGeneration = m_uiGlobalGeneration;
+  m_RemapTable.newGeneration = ++m_uiGlobalGeneration;
+  m_RemapTable.newAllocationIDs.assign(m_VertexAllocations.size(),
+                                       INVALID_ALLOCATION);
+
+  size_t l_szKept = 0;
+  for (size_t i = 0; i < m_VertexAllocations.size(); i++) {
+    SAllocation l_Vertex = m_VertexAllocations[i];
+    SAllocation l_Index = m_IndexAllcoations[i];
+
+    if (!l_Vertex.alive && !l_Index.alive)
+      continue;
+
+    // half dead pairs keep their ID, the dead half becomes an empty range
+    // where it would have been moved so pop_back() still rewinds correctly
+    if (!l_Vertex.alive) {
+      l_Vertex.offset = l_szKept == 0
+                            ? 0
+                            : m_VertexAllocations[l_szKept - 1].offset +
+                                  m_VertexAllocations[l_szKept - 1].size;
+      l_Vertex.size = 0;
+    }
+    if (!l_Index.alive) {
+      l_Index.offset = l_szKept == 0
+                           ? 0
+                           : m_IndexAllcoations[l_szKept - 1].offset +
+                                 m_IndexAllcoations[l_szKept - 1].size;
+      l_Index.size = 0;
+    }
+
+    l_Vertex.generation = m_uiGlobalGeneration;
+    l_Index.generation = m_uiGlobalGeneration;
+
+    m_VertexAllocations[l_szKept] = l_Vertex;
+    m_IndexAllcoations[l_szKept] = l_Index;
+    m_RemapTable.newAllocationIDs[i] = static_cast<uint32_t>(l_szKept);
+    l_szKept++;
+  }
+
+  m_VertexAllocations.resize(l_szKept);
+  m_IndexAllcoations.resize(l_szKept);
+
+  m_szVertexCursor = m_szCompactVertexDst;
+  m_szIndexCursor = m_szCompactIndexDst;
+  m_szVertexOccupiedSize = m_szCompactVertexDst;
+  m_szIndexOccupiedSize = m_szCompactIndexDst;
+  m_szVertexDeadSize = 0;
+  m_szIndexDeadSize = 0;
+
+  m_bCompacting = false;
+
+  SDL_Log("CGLStaticStack %u compacted: %zu allocations kept, %zu + %zu bytes "
+          "in use",
+          m_StaticStackID, l_szKept, m_szVertexCursor, m_szIndexCursor);
+}
+
+bool SStaticRemapTable::Apply(SBufferRange &p_range) const {
+  if (p_range.handle.bufferID != bufferID ||
+      p_range.handle.generation != oldGeneration ||
+      p_range.handle.allocationID >= newAllocationIDs.size())
+    return false;
+
+  uint32_t l_uiNewID = newAllocationIDs[p_range.handle.allocationID];
+  if (l_uiNewID == INVALID_ALLOCATION)
+    return false;
+
+  p_range.handle.allocationID = l_uiNewID;
+  p_range.handle.generation = newGeneration;
+  return true;
 }
 
 void CGLStaticStack::Destroy() {
@@ -227,6 +604,11 @@ void CGLStaticStack::Destroy() {
   glDeleteBuffers(1, &m_glVertexBuffer);
   glDeleteBuffers(1, &m_glIndexBuffer);
   glDeleteVertexArrays(1, &m_glVertexArray);
+
+  if (m_glScratchBuffer != 0) {
+    glDeleteBuffers(1, &m_glScratchBuffer);
+    m_glScratchBuffer = 0;
+  }
 }
 
 void CGLStaticStack::Clear() {
@@ -239,9 +621,22 @@ void CGLStaticStack::Clear() {
 
   m_szVertexOccupiedSize = 0;
   m_szIndexOccupiedSize = 0;
+  m_szVertexDeadSize = 0;
+  m_szIndexDeadSize = 0;
+
+  m_bCompacting = false;
 
   m_uiGlobalGeneration++;
 }
+SBufferMemoryStats CGLStaticStack::GetMemoryStats() const {
+
+  SBufferMemoryStats l_Stats;
+  l_Stats.capacityBytes = m_szVertexBufferSize + m_szIndexBufferSize;
+  l_Stats.wastedBytes = m_szVertexDeadSize + m_szIndexDeadSize;
+  l_Stats.occupiedBytes = m_szVertexOccupiedSize + m_szIndexOccupiedSize -
+                          l_Stats.wastedBytes;
+  return l_Stats;
+}
 void CGLStaticStack::ResizeGLBuffer(size_t p_szMinimumSizeVertex = 0,
                                     size_t p_szMinimumSizeIndex = 0) {
 
@@ -289,9 +684,43 @@ void CGLStaticStack::ResizeGLBuffer(size_t p_szMinimumSizeVertex = 0,
 }
 
 void CGLStaticStack::SetVertexAttribPointers() {
-  glBindVertexArray(m_glVertexArray);
-  glBindBuffer(GL_ARRAY_BUFFER, m_glVertexBuffer);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_glIndexBuffer);
+  ConfigureVertexArray(m_glVertexArray, m_glVertexBuffer, m_glIndexBuffer,
+                       m_VertexFormat);
+}
+
+void CGLStaticStack::ConfigureVertexArray(GLuint p_glVertexArray,
+                                          GLuint p_glVertexBuffer,
+                                          GLuint p_glIndexBuffer,
+                                          VertexFormat p_Format) {
+  glBindVertexArray(p_glVertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, p_glVertexBuffer);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_glIndexBuffer);
+
+  if (p_Format == VertexFormat::PACKED) {
+    // same locations as the full layout, the fetch unpacks to float
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, Position));
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, UV));
+    glEnableVertexAttribArray(1);
+
+    glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                          sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, Normal));
+    glEnableVertexAttribArray(2);
+
+    // no bone stream, a shader reading 3/4 gets the (0,0,0,1) default
+    glDisableVertexAttribArray(3);
+    glDisableVertexAttribArray(4);
+
+    glVertexAttribPointer(5, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                          sizeof(PackedVertex),
+                          (void *)offsetof(PackedVertex, Tangent));
+    glEnableVertexAttribArray(5);
+    return;
+  }
 
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                         (void *)offsetof(Vertex, Position));